@@ -0,0 +1,267 @@
+//GCC build cmd:  g++ -O2 -std=c++11 -I../src -o ofsmDispatchBench ofsmDispatchBench.cpp -lpthread
+//Optional: any OFSM_CONFIG_... switch that changes dispatch core, e.g. -DOFSM_CONFIG_WIDE_TIME, -DOFSM_CONFIG_INDEX_TYPE=uint32_t,
+//          -DOFSM_CONFIG_WAKEUP_INDEX, -DOFSM_CONFIG_PENDING_GROUP_BITMAP, -DOFSM_CONFIG_EVENT_BATCH_SIZE=8
+//Usage: ofsmDispatchBench [iteration count]
+//
+//Dispatch core microbenchmark, baseline for the other benchmarks: cost of queuing an event, of processing an event by single fsm,
+//of one pass of main loop over groups of different layout and of heartbeat.
+//Main loop runs synchronously (script mode, manual wakeup) with debug printing disabled, so that nothing but ofsm code is timed.
+//One line per case: dispatch_core case=<name> [layout] iterations=<n> ns_per_op=<ns> ...
+
+#define OFSM_CONFIG_SIMULATION
+#define OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE 2
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL 0
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM 0
+
+int dispatchBench(const char *arg);
+#define OFSM_CONFIG_CUSTOM_SIMULATION_EVENT_GENERATOR_FUNC dispatchBench
+
+#include <ofsm.h>
+#include <chrono>
+#include <cstdlib>
+
+#if defined(OFSM_CONFIG_EVENT_INTEREST_MASK) || defined(OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE) || defined(OFSM_CONFIG_FSM_POOL)
+#   error "ofsmDispatchBench doesn't build event interest masks, lock-free queue cells and pools of run time groups"
+#endif
+
+#define BENCH_EVENT_QUEUE_SIZE 64
+
+enum Events { Timeout = 0, Work, Unhandled };
+enum States { Idle = 0, Sleeping };
+
+void WorkHandler();
+
+/*Idle doesn't handle timeout, so that fsm stays in infinite sleep after every transition*/
+OFSMTransition transitionTable[][1 + Unhandled] = {
+    /* Timeout,              Work,                   Unhandled*/
+    { { 0, Idle },           { WorkHandler, Idle },  { 0, Idle } },     //Idle
+    { { WorkHandler, Idle }, { WorkHandler, Idle },  { 0, Sleeping } }, //Sleeping
+};
+
+unsigned long handledCount;
+
+static const int layoutGroupCounts[] = { 1, 4, 16, 64 };
+static const int layoutFsmCounts[] = { 1, 16, 64 };
+
+static void initFsm(OFSM *fsm) {
+    fsm->transitionTable = (OFSMTransition**)transitionTable;
+    fsm->transitionTableEventCount = 1 + Unhandled;
+    fsm->flags = _OFSM_FLAG_INFINITE_SLEEP;
+    fsm->currentState = Idle;
+    fsm->skipNextEventCode = (OFSM_CONFIG_INDEX_TYPE)-1;
+    fsm->simulationInitialState = Idle;
+}
+
+/*fsms and groups the same way OFSM_DECLARE_FSM and OFSM_DECLARE_GROUP_N would declare them*/
+static OFSMGroup **buildLayout(int groupCount, int fsmCount) {
+    int i, j;
+    OFSMGroup **groups = new OFSMGroup*[groupCount];
+    for (i = 0; i < groupCount; i++) {
+        OFSMGroup *group = new OFSMGroup();
+        group->groupSize = (OFSM_CONFIG_INDEX_TYPE)fsmCount;
+        group->eventQueue = new OFSMEventData[BENCH_EVENT_QUEUE_SIZE]();
+        group->eventQueueSize = BENCH_EVENT_QUEUE_SIZE;
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+        group->wakeupIndexHeap = new OFSM_CONFIG_INDEX_TYPE[fsmCount]();
+        group->wakeupIndexPosition = new OFSM_CONFIG_INDEX_TYPE[fsmCount]();
+        group->wakeupIndexFsmFlags = new uint8_t[fsmCount]();
+#endif
+        group->fsms = new OFSM*[fsmCount];
+        for (j = 0; j < fsmCount; j++) {
+            group->fsms[j] = new OFSM();
+            initFsm(group->fsms[j]);
+        }
+        groups[i] = group;
+    }
+    OFSM_SETUP_GROUPS(groups, groupCount);
+    _ofsm_start(); /*first iteration*/
+    return groups;
+}
+
+static void freeLayout(OFSMGroup **groups, int groupCount) {
+    int i, j;
+    for (i = 0; i < groupCount; i++) {
+        for (j = 0; j < (int)groups[i]->groupSize; j++) {
+            delete groups[i]->fsms[j];
+        }
+        delete[] groups[i]->fsms;
+        delete[] groups[i]->eventQueue;
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+        delete[] groups[i]->wakeupIndexHeap;
+        delete[] groups[i]->wakeupIndexPosition;
+        delete[] groups[i]->wakeupIndexFsmFlags;
+#endif
+        delete groups[i];
+    }
+    delete[] groups;
+}
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char *benchCase, unsigned long iterations, double ns) {
+    printf("dispatch_core case=%s iterations=%lu ns_per_op=%.1f\n", benchCase, iterations, ns / iterations);
+}
+
+void setup() {
+}
+
+void loop() {
+}
+
+void WorkHandler() {
+    handledCount++;
+}
+
+/*drop queued events without processing them*/
+static void resetQueue(OFSMGroup *group) {
+    group->nextEventIndex = 0;
+    group->currentEventIndex = 0;
+    group->flags &= ~_OFSM_FLAG_GROUP_BUFFER_OVERFLOW;
+}
+
+static void benchQueue(unsigned long iterations) {
+    OFSMGroup **groups = buildLayout(1, 1);
+    std::chrono::steady_clock::time_point start;
+    double ns = 0;
+    unsigned long i, batch;
+
+    /*same event code as the last queued one: data of the queued event gets replaced*/
+    ofsm_queue_group_event(0, true, Work, 0);
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < iterations; i++) {
+        ofsm_queue_group_event(0, false, Work, (OFSM_CONFIG_EVENT_DATA_TYPE)i);
+    }
+    report("queue_coalesced", iterations, elapsedNs(start));
+    resetQueue(groups[0]);
+
+    /*new event every time; queue is emptied (untimed) before it overflows*/
+    for (i = 0; i < iterations; i += batch) {
+        batch = (iterations - i < BENCH_EVENT_QUEUE_SIZE - 1 ? iterations - i : BENCH_EVENT_QUEUE_SIZE - 1);
+        start = std::chrono::steady_clock::now();
+        for (unsigned long j = 0; j < batch; j++) {
+            ofsm_queue_group_event(0, true, Work, (OFSM_CONFIG_EVENT_DATA_TYPE)j);
+        }
+        ns += elapsedNs(start);
+        resetQueue(groups[0]);
+    }
+    report("queue_forced", iterations, ns);
+    freeLayout(groups, 1);
+}
+
+static void benchProcessEvent(unsigned long iterations) {
+    OFSMGroup **groups = buildLayout(1, 1);
+    OFSM *fsm = groups[0]->fsms[0];
+    OFSMEventData e;
+    std::chrono::steady_clock::time_point start;
+    unsigned long i;
+
+#ifdef OFSM_CONFIG_SUPPORT_EVENT_DATA
+    e.eventData = 0;
+#endif
+    /*handler is called, fsm transitions back to Idle (infinite sleep)*/
+    e.eventCode = Work;
+    handledCount = 0;
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < iterations; i++) {
+        _ofsm_fsm_process_event(fsm, 0, 0, &e);
+    }
+    report("process_handled", iterations, elapsedNs(start));
+    if (handledCount != iterations) {
+        printf("dispatch_core error=handled_count_mismatch expected=%lu handled=%lu\n", iterations, handledCount);
+    }
+
+    /*no handler in current state*/
+    e.eventCode = Unhandled;
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < iterations; i++) {
+        _ofsm_fsm_process_event(fsm, 0, 0, &e);
+    }
+    report("process_unhandled", iterations, elapsedNs(start));
+
+    /*timeout before wakeup time is reached*/
+    fsm->currentState = Sleeping;
+    fsm->flags = 0;
+    fsm->wakeupTime = ((_OFSM_TIME_DATA_TYPE)-1) >> 1;
+    e.eventCode = Timeout;
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < iterations; i++) {
+        _ofsm_fsm_process_event(fsm, 0, 0, &e);
+    }
+    report("process_sleeping", iterations, elapsedNs(start));
+    freeLayout(groups, 1);
+}
+
+static void benchLoop(unsigned long iterations) {
+    std::chrono::steady_clock::time_point start;
+    unsigned long i, loopIterations;
+    int g, f, groupCount, fsmCount;
+    double ns;
+
+    for (g = 0; g < (int)(sizeof(layoutGroupCounts) / sizeof(*layoutGroupCounts)); g++) {
+        for (f = 0; f < (int)(sizeof(layoutFsmCounts) / sizeof(*layoutFsmCounts)); f++) {
+            groupCount = layoutGroupCounts[g];
+            fsmCount = layoutFsmCounts[f];
+            OFSMGroup **groups = buildLayout(groupCount, fsmCount);
+            /*keep number of visited fsms roughly the same for every layout*/
+            loopIterations = iterations / (groupCount * fsmCount) + 100;
+
+            /*no pending events: every group is visited to collect wakeup summary*/
+            start = std::chrono::steady_clock::now();
+            for (i = 0; i < loopIterations; i++) {
+                _ofsm_start();
+            }
+            ns = elapsedNs(start);
+            printf("dispatch_core case=loop_idle groups=%i fsms_per_group=%i iterations=%lu ns_per_op=%.1f ns_per_fsm=%.2f\n",
+                groupCount, fsmCount, loopIterations, ns / loopIterations, ns / loopIterations / (groupCount * fsmCount));
+
+            /*single event queued into the first group, delivered to every fsm of the group*/
+            start = std::chrono::steady_clock::now();
+            for (i = 0; i < loopIterations; i++) {
+                ofsm_queue_group_event(0, true, Work, 0);
+                _ofsm_start();
+            }
+            ns = elapsedNs(start);
+            printf("dispatch_core case=loop_event groups=%i fsms_per_group=%i iterations=%lu ns_per_op=%.1f ns_per_fsm=%.2f\n",
+                groupCount, fsmCount, loopIterations, ns / loopIterations, ns / loopIterations / (groupCount * fsmCount));
+            freeLayout(groups, groupCount);
+        }
+    }
+}
+
+static void benchHeartbeat(unsigned long iterations) {
+    OFSMGroup **groups = buildLayout(1, 1);
+    std::chrono::steady_clock::time_point start;
+    unsigned long i;
+    _OFSM_TIME_DATA_TYPE time = 0;
+
+    /*all fsms are in infinite sleep*/
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < iterations; i++) {
+        ofsm_heartbeat(++time);
+    }
+    report("heartbeat_infinite_sleep", iterations, elapsedNs(start));
+
+    /*wakeup time is scheduled, but not reached yet*/
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        _ofsmFlags &= ~_OFSM_FLAG_INFINITE_SLEEP;
+        _ofsmWakeupTime = ((_OFSM_TIME_DATA_TYPE)-1) >> 1;
+    }
+    start = std::chrono::steady_clock::now();
+    for (i = 0; i < iterations; i++) {
+        ofsm_heartbeat(++time);
+    }
+    report("heartbeat_not_due", iterations, elapsedNs(start));
+    freeLayout(groups, 1);
+}
+
+int dispatchBench(const char *arg) {
+    unsigned long iterations = (arg ? strtoul(arg, NULL, 10) : 1000000);
+
+    benchQueue(iterations);
+    benchProcessEvent(iterations);
+    benchLoop(iterations);
+    benchHeartbeat(iterations);
+    return 0;
+}
@@ -0,0 +1,171 @@
+//GCC build cmd:  g++ -O2 -std=c++11 -I../src -o ofsmInstanceBench ofsmInstanceBench.cpp -lpthread
+//Optional: -DOFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+//Usage: ofsmInstanceBench [max instance count]
+//
+//Multiple instances benchmark (OFSM_CONFIG_MULTI_INSTANCE): independent orchestras hosted by one process, each running its loop
+//on its own thread with its own producer thread, versus the same number of events pushed through single instance.
+//Every instance must handle exactly its own events (handled=... is checked), so that instances are known not to share state.
+//One line per instance count: multi_instance instances=<n> events=<total> ns_per_event=<ns> handled=<total handled>
+
+#define OFSM_CONFIG_SIMULATION
+#define OFSM_CONFIG_MULTI_INSTANCE
+#define OFSM_CONFIG_SUPPORT_EVENT_DATA
+#define OFSM_CONFIG_EVENT_DATA_TYPE uint32_t
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL 0
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM 0
+#define OFSM_CONFIG_SIMULATION_TICK_MS 100
+
+int instanceBench(const char *arg);
+#define OFSM_CONFIG_CUSTOM_SIMULATION_EVENT_GENERATOR_FUNC instanceBench
+
+#include <ofsm.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+
+#if defined(OFSM_CONFIG_EVENT_INTEREST_MASK) || defined(OFSM_CONFIG_FSM_POOL) || defined(OFSM_CONFIG_WAKEUP_INDEX)
+#   error "ofsmInstanceBench doesn't build event interest masks, pools and wakeup indices of run time groups"
+#endif
+
+#define BENCH_FSM_COUNT 4
+#define BENCH_EVENT_QUEUE_SIZE 16
+#define BENCH_EVENTS 400000 /*split between instances*/
+
+enum Events { Timeout = 0, Work };
+enum States { S0 = 0 };
+
+void CountHandler();
+
+OFSMTransition transitionTable[][1 + Work] = {
+    /* Timeout,  Work*/
+    { { 0, S0 }, { CountHandler, S0 } }, //S0
+};
+
+struct Instance {
+    OFSMContext*                context;
+    OFSMGroup*                  group;
+    unsigned long               eventCount;
+    std::atomic<unsigned long>  handledCount;       /*handler calls, BENCH_FSM_COUNT per event*/
+};
+
+void setup() {
+}
+
+void loop() {
+}
+
+void CountHandler() {
+    (fsm_get_private_data_cast(Instance*)->handledCount)++;
+    fsm_set_infinite_delay();
+}
+
+/*fsms and group the same way OFSM_DECLARE_FSM and OFSM_DECLARE_GROUP_N would declare them*/
+static OFSMGroup *buildGroup(Instance *instance) {
+    int i;
+    OFSMGroup *group = new OFSMGroup();
+    group->groupSize = BENCH_FSM_COUNT;
+    group->eventQueue = new OFSMEventData[BENCH_EVENT_QUEUE_SIZE]();
+    group->eventQueueSize = BENCH_EVENT_QUEUE_SIZE;
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+    group->eventQueueSequence = new std::atomic<uint64_t>[BENCH_EVENT_QUEUE_SIZE];
+    group->eventQueueCellLock = new std::atomic<uint8_t>[BENCH_EVENT_QUEUE_SIZE];
+#endif
+    group->fsms = new OFSM*[BENCH_FSM_COUNT];
+    for (i = 0; i < BENCH_FSM_COUNT; i++) {
+        OFSM *fsm = new OFSM();
+        fsm->transitionTable = (OFSMTransition**)transitionTable;
+        fsm->transitionTableEventCount = 1 + Work;
+        fsm->fsmPrivateInfo = instance;
+        fsm->flags = _OFSM_FLAG_INFINITE_SLEEP;
+        fsm->currentState = S0;
+        fsm->skipNextEventCode = (OFSM_CONFIG_INDEX_TYPE)-1;
+        fsm->simulationInitialState = S0;
+        group->fsms[i] = fsm;
+    }
+    return group;
+}
+
+static void freeGroup(OFSMGroup *group) {
+    int i;
+    for (i = 0; i < BENCH_FSM_COUNT; i++) {
+        delete group->fsms[i];
+    }
+    delete[] group->fsms;
+    delete[] group->eventQueue;
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+    delete[] group->eventQueueSequence;
+    delete[] group->eventQueueCellLock;
+#endif
+    delete group;
+}
+
+/*queues new event every time, but never more than queue can take, so that no event is dropped; stops the instance once all are handled*/
+static void producer(Instance *instance) {
+    unsigned long i;
+    ofsm_context_bind(instance->context);
+    for (i = 0; i < instance->eventCount; i++) {
+        while ((i * BENCH_FSM_COUNT - instance->handledCount) >= (BENCH_EVENT_QUEUE_SIZE - 1) * BENCH_FSM_COUNT) {
+            std::this_thread::yield();
+        }
+        ofsm_queue_group_event(0, true, Work, (uint32_t)i);
+    }
+    while (instance->handledCount < instance->eventCount * BENCH_FSM_COUNT) {
+        std::this_thread::yield();
+    }
+    ofsm_context_exit();
+}
+
+static void instanceThread(Instance *instance) {
+    OFSMGroup *groups[1];
+    ofsm_context_bind(instance->context);
+    groups[0] = instance->group;
+    OFSM_SETUP_GROUPS(groups, 1);
+    std::thread producerThread(producer, instance);
+    OFSM_LOOP(); /*returns after ofsm_context_exit()*/
+    producerThread.join();
+}
+
+int instanceBench(const char *arg) {
+    int maxInstances = (arg ? atoi(arg) : 8);
+    int instanceCount, i;
+    unsigned long handled;
+    std::chrono::steady_clock::time_point start;
+    double elapsedNs;
+
+    for (instanceCount = 1; instanceCount <= maxInstances; instanceCount *= 2) {
+        std::vector<Instance*> instances;
+        std::vector<std::thread> threads;
+        for (i = 0; i < instanceCount; i++) {
+            Instance *instance = new Instance();
+            instance->context = new OFSMContext();
+            instance->group = buildGroup(instance);
+            instance->eventCount = BENCH_EVENTS / instanceCount;
+            instance->handledCount = 0;
+            instances.push_back(instance);
+        }
+        start = std::chrono::steady_clock::now();
+        for (i = 0; i < instanceCount; i++) {
+            threads.push_back(std::thread(instanceThread, instances[i]));
+        }
+        for (i = 0; i < instanceCount; i++) {
+            threads[i].join();
+        }
+        elapsedNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+        handled = 0;
+        for (i = 0; i < instanceCount; i++) {
+            if (instances[i]->handledCount != instances[i]->eventCount * BENCH_FSM_COUNT) {
+                printf("multi_instance error=handled_count_mismatch instance=%i expected=%lu handled=%lu\n",
+                    i, instances[i]->eventCount * BENCH_FSM_COUNT, (unsigned long)instances[i]->handledCount);
+            }
+            handled += instances[i]->handledCount;
+            freeGroup(instances[i]->group);
+            delete instances[i]->context;
+            delete instances[i];
+        }
+        printf("multi_instance instances=%i events=%lu ns_per_event=%.1f handled=%lu\n",
+            instanceCount, (unsigned long)(BENCH_EVENTS / instanceCount) * instanceCount, elapsedNs / ((BENCH_EVENTS / instanceCount) * instanceCount), handled);
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+//GCC build cmd (10k fsms):   g++ -O2 -std=c++11 -I../src -DOFSM_CONFIG_INDEX_TYPE=uint32_t -DBENCH_FSM_COUNT=10000 -o ofsmLargeBench10k ofsmLargeBench.cpp -lpthread
+//GCC build cmd (100k fsms):  g++ -O2 -std=c++11 -I../src -DOFSM_CONFIG_INDEX_TYPE=uint32_t -DBENCH_FSM_COUNT=100000 -o ofsmLargeBench100k ofsmLargeBench.cpp -lpthread
+//Optional: -DBENCH_GROUP_SIZE=<fsms per group> (default 1000), -DOFSM_CONFIG_WAKEUP_INDEX, -DOFSM_CONFIG_PENDING_GROUP_BITMAP,
+//          -DOFSM_CONFIG_FSM_POOL (every group is a pool of instances stored as structure of arrays),
+//          -DOFSM_CONFIG_EVENT_INTEREST_MASK, -DOFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+//Usage: ofsmLargeBench [burst count]
+//
+//Large deployment benchmark: groups and fsms are built at run time (OFSM_SETUP_GROUPS) with index type wider than 8 bits.
+//Every burst queues one event into each group; the event is delivered to every fsm of the group.
+
+#define OFSM_CONFIG_SIMULATION
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL 0
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM 0
+#define OFSM_CONFIG_SIMULATION_TICK_MS 100
+
+int largeBench(const char *arg);
+#define OFSM_CONFIG_CUSTOM_SIMULATION_EVENT_GENERATOR_FUNC largeBench
+
+#include <ofsm.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#ifndef BENCH_FSM_COUNT
+#   define BENCH_FSM_COUNT 100000
+#endif
+#ifndef BENCH_GROUP_SIZE
+#   define BENCH_GROUP_SIZE 1000
+#endif
+#define BENCH_GROUP_COUNT ((BENCH_FSM_COUNT + BENCH_GROUP_SIZE - 1) / BENCH_GROUP_SIZE)
+#define BENCH_EVENT_QUEUE_SIZE 4
+
+static_assert(BENCH_GROUP_SIZE <= (OFSM_CONFIG_INDEX_TYPE)-1 && BENCH_GROUP_COUNT <= (OFSM_CONFIG_INDEX_TYPE)-1, "OFSM_CONFIG_INDEX_TYPE is too narrow for benchmark layout");
+
+enum Events { Timeout = 0, Work };
+enum States { S0 = 0 };
+
+void WorkHandler();
+
+OFSMTransition transitionTable[][1 + Work] = {
+    /* Timeout,  Work*/
+    { { 0, S0 }, { WorkHandler, S0 } }, //S0
+};
+
+OFSMGroup **benchGroups;
+std::atomic<unsigned long> handledCount;
+
+static void initFsm(OFSM *fsm) {
+    fsm->transitionTable = (OFSMTransition**)transitionTable;
+    fsm->transitionTableEventCount = 1 + Work;
+    fsm->flags = _OFSM_FLAG_INFINITE_SLEEP;
+    fsm->currentState = S0;
+    fsm->skipNextEventCode = (OFSM_CONFIG_INDEX_TYPE)-1;
+    fsm->simulationInitialState = S0;
+#ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+    fsm->transitionTableStateCount = 1; /*mask is allocated by OFSM_SETUP_GROUPS*/
+#endif
+}
+
+/*fsms and groups the same way OFSM_DECLARE_FSM and OFSM_DECLARE_GROUP_N (or OFSM_DECLARE_FSM_POOL) would declare them*/
+static void buildGroups() {
+    unsigned long i, fsmIndex = 0;
+    benchGroups = new OFSMGroup*[BENCH_GROUP_COUNT];
+    for (i = 0; i < BENCH_GROUP_COUNT; i++) {
+        unsigned long size = (BENCH_FSM_COUNT - fsmIndex < BENCH_GROUP_SIZE ? BENCH_FSM_COUNT - fsmIndex : BENCH_GROUP_SIZE);
+        OFSMGroup *group = new OFSMGroup();
+        group->groupSize = (OFSM_CONFIG_INDEX_TYPE)size;
+        group->eventQueue = new OFSMEventData[BENCH_EVENT_QUEUE_SIZE]();
+        group->eventQueueSize = BENCH_EVENT_QUEUE_SIZE;
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+        group->wakeupIndexHeap = new OFSM_CONFIG_INDEX_TYPE[size]();
+        group->wakeupIndexPosition = new OFSM_CONFIG_INDEX_TYPE[size]();
+        group->wakeupIndexFsmFlags = new uint8_t[size]();
+#endif
+#ifdef OFSM_CONFIG_FSM_POOL
+        /*instance arrays are reset by OFSM_SETUP_GROUPS*/
+        group->pool = new OFSMPool();
+        group->pool->fsm = new OFSM();
+        initFsm(group->pool->fsm);
+        group->pool->initialState = S0;
+        group->pool->currentState = new OFSM_CONFIG_INDEX_TYPE[size];
+        group->pool->flags = new uint8_t[size];
+        group->pool->wakeupTime = new _OFSM_TIME_DATA_TYPE[size];
+        group->pool->skipNextEventCode = new OFSM_CONFIG_INDEX_TYPE[size];
+#else
+        unsigned long j;
+        group->fsms = new OFSM*[size];
+        for (j = 0; j < size; j++) {
+            group->fsms[j] = new OFSM();
+            initFsm(group->fsms[j]);
+        }
+#endif
+        fsmIndex += size;
+        benchGroups[i] = group;
+    }
+}
+
+void setup() {
+    buildGroups();
+    OFSM_SETUP_GROUPS(benchGroups, BENCH_GROUP_COUNT);
+}
+
+void loop() {
+    OFSM_LOOP();
+}
+
+void WorkHandler() {
+    handledCount++;
+    fsm_set_infinite_delay();
+}
+
+int largeBench(const char *arg) {
+    int bursts = (arg ? atoi(arg) : 20);
+    int burst;
+    unsigned long i;
+    unsigned long events = 0;
+    std::chrono::steady_clock::time_point start;
+    double elapsedNs;
+
+    /*let ofsm thread to complete setup*/
+    std::this_thread::sleep_for(std::chrono::milliseconds(OFSM_CONFIG_SIMULATION_TICK_MS));
+
+    handledCount = 0;
+    start = std::chrono::steady_clock::now();
+    for (burst = 0; burst < bursts; burst++) {
+        for (i = 0; i < BENCH_GROUP_COUNT; i++) {
+            ofsm_queue_group_event((OFSM_CONFIG_INDEX_TYPE)i, true, Work, 0);
+        }
+        events += BENCH_FSM_COUNT;
+
+        /*wait for burst to be delivered to every fsm before queuing the next one*/
+        while (handledCount < events) {
+            std::this_thread::yield();
+        }
+    }
+    elapsedNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+#ifdef OFSM_CONFIG_FSM_POOL
+    printf("large_deployment impl=pool");
+#else
+    printf("large_deployment impl=fsms");
+#endif
+    printf(" index_bits=%i groups=%i fsms=%i bursts=%i fsm_events=%lu ms=%.1f ns_per_fsm_event=%.1f handled=%lu\n",
+        (int)sizeof(OFSM_CONFIG_INDEX_TYPE) * 8, BENCH_GROUP_COUNT, BENCH_FSM_COUNT, bursts, events, elapsedNs / 1000000, elapsedNs / events, (unsigned long)handledCount);
+    return 0;
+}
@@ -0,0 +1,104 @@
+//GCC build cmd (mutex):     g++ -O2 -std=c++11 -I../src -o ofsmQueueBench ofsmQueueBench.cpp -lpthread
+//GCC build cmd (lock-free): g++ -O2 -std=c++11 -I../src -DOFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE -o ofsmQueueBenchLockFree ofsmQueueBench.cpp -lpthread
+//Usage: ofsmQueueBench [max producer count]
+//
+//Event queue contention benchmark: several producer threads queue events into group queues while ofsm thread drains them.
+//Build it twice (see above) and compare ns_per_event of the same producer count.
+
+#define OFSM_CONFIG_SIMULATION
+#define OFSM_CONFIG_SUPPORT_EVENT_DATA
+#define OFSM_CONFIG_EVENT_DATA_TYPE uint32_t
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL 0
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM 0
+#define OFSM_CONFIG_SIMULATION_TICK_MS 100
+
+int queueBench(const char *arg);
+#define OFSM_CONFIG_CUSTOM_SIMULATION_EVENT_GENERATOR_FUNC queueBench
+
+#include <ofsm.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+
+#define BENCH_GROUP_COUNT 4
+#define BENCH_EVENT_QUEUE_SIZE 16
+#define BENCH_EVENTS_PER_PRODUCER 200000
+
+enum Events { Timeout = 0, E1, E2, E3 };
+enum States { S0 = 0 };
+
+void CountHandler();
+
+OFSMTransition transitionTable[][1 + E3] = {
+    /* Timeout,  E1,                  E2,                  E3*/
+    { { 0, S0 }, { CountHandler, S0 }, { CountHandler, S0 }, { CountHandler, S0 } }, //S0
+};
+
+OFSM_DECLARE_FSM(0, transitionTable, 1 + E3, NULL, NULL, S0);
+OFSM_DECLARE_FSM(1, transitionTable, 1 + E3, NULL, NULL, S0);
+OFSM_DECLARE_FSM(2, transitionTable, 1 + E3, NULL, NULL, S0);
+OFSM_DECLARE_FSM(3, transitionTable, 1 + E3, NULL, NULL, S0);
+OFSM_DECLARE_GROUP_1(0, BENCH_EVENT_QUEUE_SIZE, 0);
+OFSM_DECLARE_GROUP_1(1, BENCH_EVENT_QUEUE_SIZE, 1);
+OFSM_DECLARE_GROUP_1(2, BENCH_EVENT_QUEUE_SIZE, 2);
+OFSM_DECLARE_GROUP_1(3, BENCH_EVENT_QUEUE_SIZE, 3);
+OFSM_DECLARE_4(0, 1, 2, 3);
+
+std::atomic<unsigned long> handledCount;
+
+void setup() {
+    OFSM_SETUP();
+}
+
+void loop() {
+    OFSM_LOOP();
+}
+
+void CountHandler() {
+    handledCount++;
+    fsm_set_infinite_delay();
+}
+
+/*every producer spreads its events over all groups; odd events force new queue cell, even events may replace the last one*/
+void producer(int producerIndex) {
+    uint32_t i;
+    for (i = 0; i < BENCH_EVENTS_PER_PRODUCER; i++) {
+        ofsm_queue_group_event((uint8_t)((i + producerIndex) % BENCH_GROUP_COUNT), (i & 1) != 0, (uint8_t)(E1 + i % 3), i);
+    }
+}
+
+int queueBench(const char *arg) {
+    int maxProducers = (arg ? atoi(arg) : 8);
+    int producers, i;
+    unsigned long events;
+    std::chrono::steady_clock::time_point start;
+    double elapsedNs;
+
+    /*let ofsm thread to complete setup*/
+    std::this_thread::sleep_for(std::chrono::milliseconds(OFSM_CONFIG_SIMULATION_TICK_MS));
+
+    for (producers = 1; producers <= maxProducers; producers *= 2) {
+        std::vector<std::thread> threads;
+        handledCount = 0;
+        start = std::chrono::steady_clock::now();
+        for (i = 0; i < producers; i++) {
+            threads.push_back(std::thread(producer, i));
+        }
+        for (i = 0; i < producers; i++) {
+            threads[i].join();
+        }
+        elapsedNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        events = (unsigned long)producers * BENCH_EVENTS_PER_PRODUCER;
+
+        /*let ofsm to drain queues before reporting number of handled events*/
+        std::this_thread::sleep_for(std::chrono::milliseconds(OFSM_CONFIG_SIMULATION_TICK_MS));
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+        printf("queue_contention impl=lock_free");
+#else
+        printf("queue_contention impl=mutex");
+#endif
+        printf(" producers=%i events=%lu ns_per_event=%.1f handled=%lu\n", producers, events, elapsedNs / events, (unsigned long)handledCount);
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+//GCC build cmd (single thread):  g++ -O2 -std=c++11 -I../src -o ofsmSkewBench ofsmSkewBench.cpp -lpthread
+//GCC build cmd (rounds):         g++ -O2 -std=c++11 -I../src -DOFSM_CONFIG_SIMULATION_WORKER_THREADS=3 -o ofsmSkewBenchRounds ofsmSkewBench.cpp -lpthread
+//GCC build cmd (work stealing):  g++ -O2 -std=c++11 -I../src -DOFSM_CONFIG_SIMULATION_WORKER_THREADS=3 -DOFSM_CONFIG_SIMULATION_WORK_STEALING -o ofsmSkewBenchStealing ofsmSkewBench.cpp -lpthread
+//Usage: ofsmSkewBench [burst count]
+//
+//Skewed load benchmark: one busy group gets most of the events, four quiet groups get one event per burst.
+//Build it three ways (see above) and compare ms of the same burst count.
+
+#define OFSM_CONFIG_SIMULATION
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL 0
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM 0
+#define OFSM_CONFIG_SIMULATION_TICK_MS 100
+
+int skewBench(const char *arg);
+#define OFSM_CONFIG_CUSTOM_SIMULATION_EVENT_GENERATOR_FUNC skewBench
+
+#include <ofsm.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#define BENCH_GROUP_COUNT 5
+#define BENCH_EVENT_QUEUE_SIZE 64
+#define BENCH_BUSY_GROUP_EVENTS_PER_BURST 48
+#define BENCH_HANDLER_WORK 2000
+
+enum Events { Timeout = 0, Work };
+enum States { S0 = 0 };
+
+void WorkHandler();
+
+OFSMTransition transitionTable[][1 + Work] = {
+    /* Timeout,  Work*/
+    { { 0, S0 }, { WorkHandler, S0 } }, //S0
+};
+
+OFSM_DECLARE_FSM(0, transitionTable, 1 + Work, NULL, NULL, S0);
+OFSM_DECLARE_FSM(1, transitionTable, 1 + Work, NULL, NULL, S0);
+OFSM_DECLARE_FSM(2, transitionTable, 1 + Work, NULL, NULL, S0);
+OFSM_DECLARE_FSM(3, transitionTable, 1 + Work, NULL, NULL, S0);
+OFSM_DECLARE_FSM(4, transitionTable, 1 + Work, NULL, NULL, S0);
+OFSM_DECLARE_GROUP_1(0, BENCH_EVENT_QUEUE_SIZE, 0);
+OFSM_DECLARE_GROUP_1(1, BENCH_EVENT_QUEUE_SIZE, 1);
+OFSM_DECLARE_GROUP_1(2, BENCH_EVENT_QUEUE_SIZE, 2);
+OFSM_DECLARE_GROUP_1(3, BENCH_EVENT_QUEUE_SIZE, 3);
+OFSM_DECLARE_GROUP_1(4, BENCH_EVENT_QUEUE_SIZE, 4);
+OFSM_DECLARE_5(0, 1, 2, 3, 4);
+
+std::atomic<unsigned long> handledCount;
+std::atomic<unsigned long> workSink; /*handlers of different groups run concurrently*/
+
+void setup() {
+    OFSM_SETUP();
+}
+
+void loop() {
+    OFSM_LOOP();
+}
+
+/*same amount of work for every event, so that skew comes from event distribution only*/
+void WorkHandler() {
+    unsigned long x = 0;
+    int i;
+    for (i = 0; i < BENCH_HANDLER_WORK; i++) {
+        x += (unsigned long)i * i;
+    }
+    workSink.store(x, std::memory_order_relaxed);
+    handledCount++;
+    fsm_set_infinite_delay();
+}
+
+int skewBench(const char *arg) {
+    int bursts = (arg ? atoi(arg) : 2000);
+    int burst, i;
+    unsigned long events = 0;
+    std::chrono::steady_clock::time_point start;
+    double elapsedNs;
+
+    /*let ofsm thread to complete setup*/
+    std::this_thread::sleep_for(std::chrono::milliseconds(OFSM_CONFIG_SIMULATION_TICK_MS));
+
+    handledCount = 0;
+    start = std::chrono::steady_clock::now();
+    for (burst = 0; burst < bursts; burst++) {
+        for (i = 0; i < BENCH_BUSY_GROUP_EVENTS_PER_BURST; i++) {
+            ofsm_queue_group_event(0, true, Work, 0);
+        }
+        for (i = 1; i < BENCH_GROUP_COUNT; i++) {
+            ofsm_queue_group_event((uint8_t)i, true, Work, 0);
+        }
+        events += BENCH_BUSY_GROUP_EVENTS_PER_BURST + BENCH_GROUP_COUNT - 1;
+
+        /*burst fits into queues; wait for it to be handled before queuing the next one*/
+        while (handledCount < events) {
+            std::this_thread::yield();
+        }
+    }
+    elapsedNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+#if defined(OFSM_CONFIG_SIMULATION_WORK_STEALING)
+    printf("skewed_load impl=work_stealing workers=%i", OFSM_CONFIG_SIMULATION_WORKER_THREADS);
+#elif defined(OFSM_CONFIG_SIMULATION_WORKER_THREADS)
+    printf("skewed_load impl=rounds workers=%i", OFSM_CONFIG_SIMULATION_WORKER_THREADS);
+#else
+    printf("skewed_load impl=single_thread workers=0");
+#endif
+    printf(" bursts=%i events=%lu ms=%.1f ns_per_event=%.1f handled=%lu\n", bursts, events, elapsedNs / 1000000, elapsedNs / events, (unsigned long)handledCount);
+    return 0;
+}
@@ -0,0 +1,90 @@
+//GCC build cmd (group loop):    g++ -O2 -std=c++11 -I../src -o ofsmTimeoutBench ofsmTimeoutBench.cpp -lpthread
+//GCC build cmd (SSE2 sweep):    g++ -O2 -std=c++11 -I../src -DOFSM_CONFIG_SIMD_TIMEOUT_SWEEP -o ofsmTimeoutBenchSse2 ofsmTimeoutBench.cpp -lpthread
+//GCC build cmd (AVX2 sweep):    g++ -O2 -mavx2 -std=c++11 -I../src -DOFSM_CONFIG_SIMD_TIMEOUT_SWEEP -o ofsmTimeoutBenchAvx2 ofsmTimeoutBench.cpp -lpthread
+//GCC build cmd (scalar sweep):  g++ -O2 -mno-sse2 -std=c++11 -I../src -DOFSM_CONFIG_SIMD_TIMEOUT_SWEEP -o ofsmTimeoutBenchScalar ofsmTimeoutBench.cpp -lpthread
+//Optional: -DBENCH_INSTANCE_COUNT=<pool size> (default 100000)
+//Usage: ofsmTimeoutBench [period count]
+//
+//Timeout benchmark: pool of identical fsms, each one times out once per BENCH_PERIOD ticks, deadlines are spread over the period,
+//so that only a small fraction of the pool is due at every tick. Virtual time jumps from one wakeup time to the next one.
+
+#define OFSM_CONFIG_SIMULATION
+#define OFSM_CONFIG_SIMULATION_VIRTUAL_TIME
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL 0
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM 0
+#define OFSM_CONFIG_WIDE_TIME
+#define OFSM_CONFIG_FSM_POOL
+#define OFSM_CONFIG_INDEX_TYPE uint32_t
+
+int timeoutBench(const char *arg);
+#define OFSM_CONFIG_CUSTOM_SIMULATION_EVENT_GENERATOR_FUNC timeoutBench
+
+#include <ofsm.h>
+#include <chrono>
+#include <cstdlib>
+
+#ifndef BENCH_INSTANCE_COUNT
+#   define BENCH_INSTANCE_COUNT 100000
+#endif
+#define BENCH_PERIOD 1000
+
+enum Events { Timeout = 0, Start };
+enum States { Idle = 0, Running };
+
+void StartHandler();
+void TickHandler();
+
+OFSMTransition transitionTable[][1 + Start] = {
+    /* Timeout,             Start*/
+    { { 0, Idle },          { StartHandler, Running } },  //Idle
+    { { TickHandler, Running }, { 0, Running } },         //Running
+};
+
+OFSM_DECLARE_FSM_POOL(0, 4, BENCH_INSTANCE_COUNT, transitionTable, 1 + Start, NULL, NULL, Idle);
+OFSM_DECLARE_1(0);
+
+unsigned long timeoutCount;
+
+void setup() {
+    OFSM_SETUP();
+}
+
+void loop() {
+    OFSM_LOOP();
+}
+
+/*spread first deadlines over the period*/
+void StartHandler() {
+    fsm_set_transition_delay(1 + ((unsigned long)fsm_get_fsm_index() * 7919) % BENCH_PERIOD);
+}
+
+void TickHandler() {
+    timeoutCount++;
+    fsm_set_transition_delay(BENCH_PERIOD);
+}
+
+int timeoutBench(const char *arg) {
+    int periods = (arg ? atoi(arg) : 10);
+    std::chrono::steady_clock::time_point start;
+    double elapsedNs;
+
+    ofsm_queue_group_event(0, false, Start, 0);
+    _ofsm_simulation_virtual_time_advance(0);
+    timeoutCount = 0;
+    start = std::chrono::steady_clock::now();
+    _ofsm_simulation_virtual_time_advance((_OFSM_TIME_DATA_TYPE)periods * BENCH_PERIOD + 1);
+    elapsedNs = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+#if defined(_OFSM_TIMEOUT_SWEEP_AVX2)
+    printf("timeout_sweep impl=avx2");
+#elif defined(_OFSM_TIMEOUT_SWEEP_SSE2)
+    printf("timeout_sweep impl=sse2");
+#elif defined(OFSM_CONFIG_SIMD_TIMEOUT_SWEEP)
+    printf("timeout_sweep impl=scalar");
+#else
+    printf("timeout_sweep impl=group_loop");
+#endif
+    printf(" instances=%i periods=%i ticks=%i timeouts=%lu ms=%.1f ns_per_tick=%.1f ns_per_timeout=%.1f\n",
+        BENCH_INSTANCE_COUNT, periods, periods * BENCH_PERIOD, timeoutCount, elapsedNs / 1000000, elapsedNs / ((double)periods * BENCH_PERIOD), elapsedNs / timeoutCount);
+    return 0;
+}
@@ -26,7 +26,49 @@
 #	include <locale>
 #   include <string.h>
 #	include <stdio.h>
-#   define _OFSM_TIME_DATA_TYPE unsigned long
+#   ifdef _MSC_VER
+#       include <vector>
+#       include <iterator>
+#   else
+#       include <sys/mman.h> /*binary script replay*/
+#       include <sys/stat.h>
+#       include <fcntl.h>
+#       include <unistd.h>
+#   endif
+#   if defined(OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE) || defined(OFSM_CONFIG_SIMULATION_WORKER_THREADS)
+#       include <atomic>
+#   endif
+#else
+#   undef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE /*simulation only*/
+#   undef OFSM_CONFIG_SIMULATION_TICKLESS /*simulation only*/
+#   undef OFSM_CONFIG_SIMULATION_VIRTUAL_TIME /*simulation only*/
+#   undef OFSM_CONFIG_SIMULATION_WORKER_THREADS /*simulation only*/
+#   undef OFSM_CONFIG_MULTI_INSTANCE /*simulation only*/
+#   ifdef OFSM_CONFIG_TRANSITION_TABLE_IN_FLASH
+#       include <avr/pgmspace.h>
+#   endif
+#endif
+
+#ifndef OFSM_CONFIG_FSM_POOL
+#   undef OFSM_CONFIG_SIMD_TIMEOUT_SWEEP /*sweeps per instance arrays of pool groups*/
+#endif
+
+/*timeout sweep instruction set: 64 bit lanes of wakeup time (AVX2: 4, SSE2: 2); scalar sweep otherwise*/
+#ifdef OFSM_CONFIG_SIMD_TIMEOUT_SWEEP
+#   if defined(OFSM_CONFIG_WIDE_TIME) || (defined(__SIZEOF_LONG__) && __SIZEOF_LONG__ == 8)
+#       if defined(__AVX2__)
+#           include <immintrin.h>
+#           define _OFSM_TIMEOUT_SWEEP_AVX2
+#       elif defined(__SSE2__)
+#           include <emmintrin.h>
+#           define _OFSM_TIMEOUT_SWEEP_SSE2
+#       endif
+#   endif
+#endif
+
+/*time: 64 bit time never wraps (for any practical uptime), so time overflow bookkeeping is not needed*/
+#ifdef OFSM_CONFIG_WIDE_TIME
+#   define _OFSM_TIME_DATA_TYPE uint64_t
 #else
 #   define _OFSM_TIME_DATA_TYPE unsigned long
 #endif
@@ -36,6 +78,54 @@
 #	define OFSM_CONFIG_EVENT_DATA_TYPE uint8_t
 #endif
 
+/*default index type: event codes, states, group count and size, group/fsm indices, event queue size and indices*/
+#ifndef OFSM_CONFIG_INDEX_TYPE
+#	define OFSM_CONFIG_INDEX_TYPE uint8_t
+#endif
+
+/*handler profiling: number of (group, fsm, state, event) slots and of duration histogram buckets*/
+#ifdef OFSM_CONFIG_PROFILING
+#   ifndef OFSM_CONFIG_PROFILING_SLOT_COUNT
+#       define OFSM_CONFIG_PROFILING_SLOT_COUNT 16
+#   endif
+#   ifndef OFSM_CONFIG_PROFILING_BUCKET_COUNT
+#       ifdef OFSM_CONFIG_SIMULATION
+#           define OFSM_CONFIG_PROFILING_BUCKET_COUNT 32 /*host clock ticks are cpu cycles or nanoseconds*/
+#       else
+#           define OFSM_CONFIG_PROFILING_BUCKET_COUNT 16
+#       endif
+#   endif
+#endif
+
+/*binary trace: ring buffer of OFSM_CONFIG_TRACE_BUFFER_SIZE records; record counter is shared with producers that don't take simulation mutex*/
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+#   if (OFSM_CONFIG_TRACE_BUFFER_SIZE) & ((OFSM_CONFIG_TRACE_BUFFER_SIZE) - 1)
+#       error "OFSM_CONFIG_TRACE_BUFFER_SIZE must be power of 2"
+#   endif
+#   ifdef OFSM_CONFIG_SIMULATION
+#       include <atomic>
+#       define _OFSM_TRACE_COUNTER_DATA_TYPE std::atomic<uint32_t>
+#   else
+#       define _OFSM_TRACE_COUNTER_DATA_TYPE volatile uint32_t
+#   endif
+typedef void(*OFSMTraceWriter)(const uint8_t *data, uint16_t size);
+#   define _OFSM_TRACE(type, groupIndex, fsmIndex, code, flags, value) _ofsm_trace(type, groupIndex, fsmIndex, code, flags, value)
+#else
+#   define _OFSM_TRACE(type, groupIndex, fsmIndex, code, flags, value)
+#endif
+
+/*trace record types:                                   groupIndex fsmIndex  code           flags                     value*/
+#define _OFSM_TRACE_ENQUEUE                 1       /*  group      -         event code     _OFSM_TRACE_FLAG_...      event data*/
+#define _OFSM_TRACE_DROP                    2       /*  group      -         event code     -                         event data (queue overflow)*/
+#define _OFSM_TRACE_DISPATCH                3       /*  group      fsm       event code     -                         current state*/
+#define _OFSM_TRACE_TRANSITION              4       /*  group      fsm       event code     -                         (old state << 16) | new state*/
+#define _OFSM_TRACE_DELAY                   5       /*  group      fsm       new state      -                         delay ticks (0xFFFFFFFF - infinite)*/
+#define _OFSM_TRACE_SLEEP_ENTER             6       /*  -          -         -              deep sleep allowed        wakeup time (0xFFFFFFFF - infinite)*/
+#define _OFSM_TRACE_SLEEP_EXIT              7       /*  -          -         -              -                         -*/
+#define _OFSM_TRACE_HEARTBEAT               8       /*  -          -         -              -                         reached wakeup time (timeout is queued)*/
+#define _OFSM_TRACE_FLAG_REPLACED           0x1     /*enqueue: data of the last queued event replaced, otherwise new event is queued*/
+#define _OFSM_TRACE_INFINITE                0xFFFFFFFFUL
+
 /*--------------------------------
 Type definitions
 ----------------------------------*/
@@ -44,6 +134,8 @@ struct OFSMEventData;
 struct OFSM;
 struct OFSMState;
 struct OFSMGroup;
+struct OFSMPool;
+struct OFSMProfile;
 typedef void(*OFSMHandler)();
 
 /*#define ofsm_get_time(time,timeFlags) //see implementation below */
@@ -55,14 +147,72 @@ Sketch code that uses this function may be left untouched when compiled for MCU
 -------------------------------------------------*/
 /*#define ofsm_debug_printf(...) //see implementation below*/
 
-void ofsm_queue_global_event(bool forceNewEvent, uint8_t eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData);
-void ofsm_queue_group_event(uint8_t groupIndex, bool forceNewEvent, uint8_t eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData);
+void ofsm_queue_global_event(bool forceNewEvent, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData);
+void ofsm_queue_group_event(OFSM_CONFIG_INDEX_TYPE groupIndex, bool forceNewEvent, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData);
 static inline void ofsm_heartbeat(_OFSM_TIME_DATA_TYPE currentTime)  __attribute__((__always_inline__));
+#ifdef OFSM_CONFIG_WIDE_TIME
+static inline void ofsm_heartbeat_32(uint32_t currentTime)  __attribute__((__always_inline__));
+#endif
 
-void _ofsm_queue_group_event(uint8_t groupIndex, OFSMGroup *group, bool forceNewEvent, uint8_t eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData);
-static inline void _ofsm_group_process_pending_event(OFSMGroup *group, uint8_t groupIndex, _OFSM_TIME_DATA_TYPE *groupEarliestWakeupTime, uint8_t *groupAndedFsmFlags) __attribute__((__always_inline__));
-static inline void _ofsm_fsm_process_event(OFSM *fsm, uint8_t groupIndex, uint8_t fsmIndex, OFSMEventData *e) __attribute__((__always_inline__));
+void _ofsm_queue_group_event(OFSM_CONFIG_INDEX_TYPE groupIndex, OFSMGroup *group, bool forceNewEvent, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData);
+static inline void _ofsm_group_process_pending_event(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE groupIndex, _OFSM_TIME_DATA_TYPE *groupEarliestWakeupTime, uint8_t *groupAndedFsmFlags) __attribute__((__always_inline__));
+static inline void _ofsm_fsm_get_transition(OFSM *fsm, OFSM_CONFIG_INDEX_TYPE state, OFSM_CONFIG_INDEX_TYPE eventCode, OFSMTransition *t) __attribute__((__always_inline__));
+static inline uint8_t _ofsm_fsm_process_event(OFSM *fsm, OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSMEventData *e) __attribute__((__always_inline__));
+#ifdef OFSM_CONFIG_RUN_TO_COMPLETION_DEPTH
+static inline void _ofsm_fsm_run_to_completion(OFSM *fsm, OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSMEventData *e) __attribute__((__always_inline__));
+#endif
 static inline void _ofsm_check_timeout() __attribute__((__always_inline__));
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+static void _ofsm_wakeup_index_sift(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE heapPosition);
+static void _ofsm_wakeup_index_update(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE fsmIndex);
+static void _ofsm_wakeup_index_rebuild(OFSMGroup *group);
+#endif
+#ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+static void _ofsm_fsm_build_event_interest_mask(OFSM *fsm);
+#endif
+#ifdef OFSM_CONFIG_FSM_POOL
+static inline OFSM *_ofsm_group_fsm_load(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE fsmIndex) __attribute__((__always_inline__));
+static inline void _ofsm_group_fsm_store(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE fsmIndex) __attribute__((__always_inline__));
+static void _ofsm_pool_reset(OFSMGroup *group);
+#endif
+#ifdef OFSM_CONFIG_SIMD_TIMEOUT_SWEEP
+static inline uint64_t _ofsm_pool_timeout_sweep_due(OFSMPool *pool, unsigned long first, uint8_t count, _OFSM_TIME_DATA_TYPE currentTime, uint8_t timeFlags, uint8_t blockingFlags) __attribute__((__always_inline__));
+static inline void _ofsm_pool_timeout_sweep_summary(OFSMPool *pool, unsigned long first, uint8_t count, _OFSM_TIME_DATA_TYPE *earliestWakeupTime, uint8_t *andedFsmFlags) __attribute__((__always_inline__));
+static void _ofsm_pool_timeout_sweep(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE groupIndex, OFSMEventData *e, _OFSM_TIME_DATA_TYPE *earliestWakeupTime, uint8_t *andedFsmFlags);
+#endif
+#ifdef OFSM_CONFIG_PROFILING
+static inline void _ofsm_profile_record(OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSM_CONFIG_INDEX_TYPE state, OFSM_CONFIG_INDEX_TYPE eventCode, uint32_t duration, uint8_t transitioned) __attribute__((__always_inline__));
+OFSMProfile* ofsm_query_profile_find(OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSM_CONFIG_INDEX_TYPE state, OFSM_CONFIG_INDEX_TYPE eventCode);
+void ofsm_profile_reset();
+#endif
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+static inline void _ofsm_trace(uint8_t type, OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSM_CONFIG_INDEX_TYPE code, uint8_t flags, uint32_t value) __attribute__((__always_inline__));
+void ofsm_trace_dump(OFSMTraceWriter writer);
+void ofsm_trace_reset();
+#endif
+#ifdef OFSM_CONFIG_SNAPSHOT
+static uint32_t _ofsm_snapshot_walk(uint8_t *buffer, uint8_t mode);
+uint32_t ofsm_snapshot_size();
+uint32_t ofsm_snapshot_save(uint8_t *buffer, uint32_t bufferSize);
+bool ofsm_snapshot_restore(const uint8_t *buffer, uint32_t size);
+#endif
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+static void _ofsm_simulation_lock_free_queue_reset(OFSMGroup *group);
+static OFSM_CONFIG_INDEX_TYPE _ofsm_simulation_lock_free_queue_pending_count(OFSMGroup *group);
+static int8_t _ofsm_simulation_lock_free_queue_replace_last(OFSMGroup *group, uint64_t tail, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData);
+static uint8_t _ofsm_simulation_lock_free_queue_push(OFSMGroup *group, bool forceNewEvent, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData);
+static bool _ofsm_simulation_lock_free_queue_pop(OFSMGroup *group, OFSMEventData *e);
+#endif
+#ifdef OFSM_CONFIG_SIMULATION_VIRTUAL_TIME
+void _ofsm_simulation_virtual_time_advance(_OFSM_TIME_DATA_TYPE targetTime);
+#endif
+#ifdef OFSM_CONFIG_SIMULATION_TICKLESS
+void _ofsm_simulation_tickless_heartbeat();
+void _ofsm_simulation_tickless_deadline_published();
+#endif
+#if defined(OFSM_CONFIG_SIMULATION) && defined(OFSM_CONFIG_PENDING_GROUP_BITMAP)
+void _ofsm_simulation_setup_pending_group_bitmap(OFSM_CONFIG_INDEX_TYPE groupCount);
+#endif
 void _ofsm_setup();
 void _ofsm_start();
 
@@ -160,10 +310,28 @@ OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) { \
 #	define OFSM_CONFIG_SIMULATION_SCRIPT_MODE
 #endif
 
+#ifdef OFSM_CONFIG_SIMULATION_VIRTUAL_TIME
+#	define OFSM_CONFIG_SIMULATION_SCRIPT_MODE /*virtual time is driven by the script*/
+#endif
+
 #ifndef OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE
 #   define OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE 3
 #endif
 
+#ifdef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
+#   undef OFSM_CONFIG_SIMULATION_TICKLESS /*heartbeat is driven by the script*/
+#   undef OFSM_CONFIG_SIMULATION_WORKER_THREADS /*script runs ofsm synchronously (and may re-enter it) in single thread*/
+#endif
+
+#ifdef OFSM_CONFIG_MULTI_INSTANCE
+#   undef OFSM_CONFIG_SIMULATION_WORKER_THREADS /*worker pool is shared by the process, instances run on their own threads instead*/
+#   undef OFSM_CONFIG_SIMULATION_TICKLESS /*tickless epoch, offset and deadline are shared by the process*/
+#endif
+
+#ifndef OFSM_CONFIG_SIMULATION_WORKER_THREADS
+#   undef OFSM_CONFIG_SIMULATION_WORK_STEALING /*schedules groups onto worker pool*/
+#endif
+
 #ifndef OFSM_CONFIG_CUSTOM_SIMULATION_EVENT_GENERATOR_FUNC
     int _ofsm_simulation_event_generator(const char *fileName);
 #	define OFSM_CONFIG_CUSTOM_SIMULATION_EVENT_GENERATOR_FUNC _ofsm_simulation_event_generator
@@ -183,13 +351,17 @@ OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) { \
 #endif
 
 #ifndef OFSM_CONFIG_ATOMIC_BLOCK
-    static std::recursive_mutex _ofsm_simulation_mutex;
-    static uint8_t _ofsm_simulation_atomic_counter;
 #	ifdef OFSM_CONFIG_ATOMIC_RESTORESTATE
 #		undef OFSM_CONFIG_ATOMIC_RESTORESTATE
 #	endif
-#	define OFSM_CONFIG_ATOMIC_RESTORESTATE _ofsm_simulation_mutex
-#	define OFSM_CONFIG_ATOMIC_BLOCK(type) for(type.lock(), _ofsm_simulation_atomic_counter = 0; _ofsm_simulation_atomic_counter++ < 1; type.unlock())
+#   ifdef OFSM_CONFIG_MULTI_INSTANCE
+#	    define OFSM_CONFIG_ATOMIC_RESTORESTATE (_ofsmContext->simulationMutex) /*instances don't serialize on each other*/
+#   else
+    static std::recursive_mutex _ofsm_simulation_mutex;
+#	    define OFSM_CONFIG_ATOMIC_RESTORESTATE _ofsm_simulation_mutex
+#   endif
+    /*loop control variable is local to the block, so that blocks entered concurrently by different threads don't share it*/
+#	define OFSM_CONFIG_ATOMIC_BLOCK(type) for(bool _ofsm_atomic_block_once = (type.lock(), true); _ofsm_atomic_block_once; _ofsm_atomic_block_once = false, type.unlock())
 #endif /*OFSM_CONFIG_ATOMIC_BLOCK*/
 
 #ifndef OFSM_CONFIG_SIMULATION_SLEEP_BETWEEN_EVENTS_MS
@@ -202,6 +374,15 @@ OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) { \
 #   define _OFSM_IMPL_SIMULATION_STATUS_REPORT_PRINTER
 #endif
 
+#if defined(OFSM_CONFIG_PROFILING) && !defined(OFSM_CONFIG_CUSTOM_PROFILING_CLOCK_FUNC)
+    static inline uint32_t _ofsm_simulation_profiling_clock() __attribute__((__always_inline__));
+#   define OFSM_CONFIG_CUSTOM_PROFILING_CLOCK_FUNC _ofsm_simulation_profiling_clock
+#   define _OFSM_IMPL_SIMULATION_PROFILING_CLOCK
+#   if defined(__x86_64__) || defined(__i386__)
+#       include <x86intrin.h> /*__rdtsc()*/
+#   endif
+#endif
+
 #else /*is NOT OFSM_CONFIG_SIMULATION*/
 
 static inline void _ofsm_enter_idle_sleep(unsigned long sleepPeriodUs) __attribute__((__always_inline__));
@@ -217,6 +398,14 @@ static inline unsigned long _ofsm_sleep_timer_get_time_left_us() __attribute__((
 #   define OFSM_CONFIG_CUSTOM_SLEEP_TIMER_GET_TIME_LEFT_US_FUNC _ofsm_sleep_timer_get_time_left_us
 #endif
 
+/*handler durations are measured in microseconds, unless cycle counter (e.g. hardware timer register) is provided*/
+#if defined(OFSM_CONFIG_PROFILING) && !defined(OFSM_CONFIG_CUSTOM_PROFILING_CLOCK_FUNC)
+#   ifdef OFSM_CONFIG_CUSTOM_HEARTBEAT_PROVIDER
+#       error "OFSM_CONFIG_PROFILING requires OFSM_CONFIG_CUSTOM_PROFILING_CLOCK_FUNC when OFSM_CONFIG_CUSTOM_HEARTBEAT_PROVIDER is defined"
+#   endif
+#   define OFSM_CONFIG_CUSTOM_PROFILING_CLOCK_FUNC OFSM_CONFIG_CUSTOM_MICROS_FUNC
+#endif
+
 #include <avr/sleep.h>
 #include <avr/wdt.h>
 #include <avr/power.h>
@@ -295,13 +484,76 @@ static inline void _ofsm_enter_sleep() __attribute__((__always_inline__));
 /*--------------------------------
 Type definitions
 ----------------------------------*/
+/*transition tables in program memory: declare every table (dense table, sparse rows and row array, compact handler array) with OFSM_FLASH attribute.
+In simulation tables stay in regular memory, but are still read through _OFSM_TABLE_READ (plain memcpy)*/
+#ifdef OFSM_CONFIG_TRANSITION_TABLE_IN_FLASH
+#   ifdef OFSM_CONFIG_SIMULATION
+#       define OFSM_FLASH
+#       define _OFSM_TABLE_READ(dstPtr, srcPtr) memcpy((dstPtr), (srcPtr), sizeof(*(dstPtr)))
+#   else
+#       define OFSM_FLASH PROGMEM
+#       define _OFSM_TABLE_READ(dstPtr, srcPtr) memcpy_P((dstPtr), (srcPtr), sizeof(*(dstPtr)))
+#   endif
+#else
+#   define OFSM_FLASH
+#   define _OFSM_TABLE_READ(dstPtr, srcPtr) (*(dstPtr) = *(srcPtr))
+#endif /*OFSM_CONFIG_TRANSITION_TABLE_IN_FLASH*/
+
+/*FSMs may use other than regular (dense) transition table*/
+#if defined(OFSM_CONFIG_COMPACT_TRANSITION_TABLE) || defined(OFSM_CONFIG_SPARSE_TRANSITION_TABLE)
+#   define _OFSM_TRANSITION_TABLE_TYPES
+#endif
+
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+/*flags and pending group bitmap are modified by producers without taking simulation mutex*/
+#   define _OFSM_FLAGS_DATA_TYPE std::atomic<uint16_t>
+#   define _OFSM_PENDING_GROUP_DATA_TYPE std::atomic<uint8_t>
+#elif defined(OFSM_CONFIG_SIMULATION_WORKER_THREADS)
+/*flags are read by workers without taking simulation mutex*/
+#   define _OFSM_FLAGS_DATA_TYPE std::atomic<uint16_t>
+#   define _OFSM_PENDING_GROUP_DATA_TYPE uint8_t
+#else
+#   define _OFSM_FLAGS_DATA_TYPE uint16_t
+#   define _OFSM_PENDING_GROUP_DATA_TYPE uint8_t
+#endif
+
+/*worker threads: handlers of different groups run concurrently, each thread has its own current fsm state;
+multiple instances: each thread has its own bound context and current fsm state*/
+#if defined(OFSM_CONFIG_SIMULATION_WORKER_THREADS) || defined(OFSM_CONFIG_MULTI_INSTANCE)
+#   define _OFSM_THREAD_LOCAL thread_local
+#else
+#   define _OFSM_THREAD_LOCAL
+#endif
+
+/*groups cache their wakeup summary when not all of them are processed by ofsm thread on every loop*/
+#if defined(OFSM_CONFIG_PENDING_GROUP_BITMAP) || defined(OFSM_CONFIG_SIMULATION_WORKER_THREADS)
+#   define _OFSM_GROUP_SUMMARY_CACHE
+#endif
+
 struct OFSMTransition {
     OFSMHandler eventHandler;
-    uint8_t newState;
+    OFSM_CONFIG_INDEX_TYPE newState;
 };
 
+#ifdef OFSM_CONFIG_SPARSE_TRANSITION_TABLE
+/*sparse transition table entry, see OFSM_DECLARE_SPARSE_FSM*/
+struct OFSMSparseTransition {
+    OFSM_CONFIG_INDEX_TYPE eventCode;
+    OFSMHandler eventHandler;
+    OFSM_CONFIG_INDEX_TYPE newState;
+};
+#endif
+
+#ifdef OFSM_CONFIG_COMPACT_TRANSITION_TABLE
+/*compact transition table cell, see ofsm.table.h*/
+struct OFSMCompactTransition {
+    uint8_t handlerIndex;   /*0 - no handler; OFSM_COMPACT_NOP_HANDLER_INDEX - OFSM_NOP_HANDLER; otherwise index into handler array + 1*/
+    OFSM_CONFIG_INDEX_TYPE newState;
+};
+#endif
+
 struct OFSMEventData {
-    uint8_t                     eventCode;
+    OFSM_CONFIG_INDEX_TYPE      eventCode;
 #ifdef OFSM_CONFIG_SUPPORT_EVENT_DATA
     OFSM_CONFIG_EVENT_DATA_TYPE eventData;
 #endif
@@ -309,49 +561,134 @@ struct OFSMEventData {
 
 struct OFSM {
     OFSMTransition**    transitionTable;
-    uint8_t             transitionTableEventCount;  /*number of elements in each row (number of events defined)*/
+    OFSM_CONFIG_INDEX_TYPE transitionTableEventCount; /*number of elements in each row (number of events defined)*/
     void*               fsmPrivateInfo;
     uint8_t             flags;
     _OFSM_TIME_DATA_TYPE wakeupTime;
-    uint8_t             currentState;
-    uint8_t             skipNextEventCode;     /* skip (once) processing of specified event event code */
+    OFSM_CONFIG_INDEX_TYPE currentState;
+    OFSM_CONFIG_INDEX_TYPE skipNextEventCode;     /* skip (once) processing of specified event event code */
 #ifdef OFSM_CONFIG_SUPPORT_INITIALIZATION_HANDLER
     OFSMHandler         initHandler;                /*optional, can be null*/
 #endif
 #ifdef OFSM_CONFIG_SIMULATION
-    uint8_t             simulationInitialState; /* store initial state, so that it can be restored during simulation reset*/
+    OFSM_CONFIG_INDEX_TYPE simulationInitialState; /* store initial state, so that it can be restored during simulation reset*/
 #endif /* OFSM_CONFIG_SIMULATION */
+#ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+    uint8_t*            eventInterestMask;          /*per state bitmask of event codes that have a handler; (transitionTableEventCount + 7) / 8 bytes per state*/
+    OFSM_CONFIG_INDEX_TYPE transitionTableStateCount;  /*number of rows in transition table (number of states defined)*/
+#endif
+#ifdef _OFSM_TRANSITION_TABLE_TYPES
+    uint8_t             transitionTableType;        /*_OFSM_TRANSITION_TABLE_TYPE_...*/
+#endif
+#ifdef OFSM_CONFIG_COMPACT_TRANSITION_TABLE
+    const OFSMHandler*  transitionHandlers;         /*compact table: handlers referenced by cells*/
+#endif
 };
 
+#ifdef OFSM_CONFIG_FSM_POOL
+/*pool of identical fsms stored as structure of arrays, keyed by instance index (fsm index within the group).
+Instances share single fsm (transition table, initialization handler, private data); per instance fields are loaded into it while instance is processed*/
+struct OFSMPool {
+    OFSM*                   fsm;
+    OFSM_CONFIG_INDEX_TYPE  initialState;
+    OFSM_CONFIG_INDEX_TYPE* currentState;
+    uint8_t*                flags;
+    _OFSM_TIME_DATA_TYPE*   wakeupTime;
+    OFSM_CONFIG_INDEX_TYPE* skipNextEventCode;
+};
+#endif
+
 struct OFSMState {
     OFSM					*fsm;
     OFSMEventData*			e;
     _OFSM_TIME_DATA_TYPE	timeLeftBeforeTimeout;      /*time left before timeout set by previous transition*/
-    uint8_t					groupIndex;                 /*group index where current fsm is registered*/
-    uint8_t					fsmIndex;	                /*fsm index within group*/
+    OFSM_CONFIG_INDEX_TYPE	groupIndex;                 /*group index where current fsm is registered*/
+    OFSM_CONFIG_INDEX_TYPE	fsmIndex;	                /*fsm index within group*/
 };
 
 struct OFSMGroup {
     OFSM**					fsms;
-    uint8_t					groupSize;
+    OFSM_CONFIG_INDEX_TYPE	groupSize;
     OFSMEventData*			eventQueue;
-    uint8_t					eventQueueSize;
+    OFSM_CONFIG_INDEX_TYPE	eventQueueSize;
 
     volatile uint8_t		flags;
-    volatile uint8_t		nextEventIndex; //queue cell index that is available for new event
-    volatile uint8_t		currentEventIndex; //queue cell that is being processed by ofsm
+    volatile OFSM_CONFIG_INDEX_TYPE nextEventIndex; //queue cell index that is available for new event
+    volatile OFSM_CONFIG_INDEX_TYPE currentEventIndex; //queue cell that is being processed by ofsm
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+    OFSM_CONFIG_INDEX_TYPE* wakeupIndexHeap;            /*indices of fsms that are not in infinite sleep, ordered as binary min-heap by wakeup time*/
+    OFSM_CONFIG_INDEX_TYPE* wakeupIndexPosition;        /*per fsm: position within the heap + 1; 0 - fsm is not in the heap*/
+    uint8_t*                wakeupIndexFsmFlags;        /*per fsm: fsm flags at the time of last re-key*/
+    OFSM_CONFIG_INDEX_TYPE  wakeupIndexSize;            /*number of fsms in the heap*/
+    OFSM_CONFIG_INDEX_TYPE  wakeupIndexNoDeepSleepCount; /*number of fsms that don't allow deep sleep*/
+#endif
+#ifdef _OFSM_GROUP_SUMMARY_CACHE
+    _OFSM_TIME_DATA_TYPE    earliestWakeupTime;         /*cached result of the last processing of the group*/
+    uint8_t                 andedFsmFlags;              /*cached result of the last processing of the group*/
+#endif
+#ifdef OFSM_CONFIG_FSM_POOL
+    OFSMPool*               pool;                       /*pool group: fsms is NULL and groupSize is number of pool instances*/
+#endif
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+    std::atomic<uint64_t>*  eventQueueSequence;         /*per queue cell: n - cell is free for n-th event, n + 1 - n-th event is published*/
+    std::atomic<uint8_t>*   eventQueueCellLock;         /*per queue cell: held while ofsm takes the event or producer replaces its data*/
+    std::atomic<uint64_t>   eventQueueHead;             /*number of events taken by ofsm*/
+    std::atomic<uint64_t>   eventQueueTail;             /*number of events claimed by producers*/
+#endif
 };
 
+#ifdef OFSM_CONFIG_PROFILING
+/*handler profile of (group, fsm, state, event); durations are in ticks of OFSM_CONFIG_CUSTOM_PROFILING_CLOCK_FUNC.
+Histogram bucket b counts durations of b significant bits (bucket 0: zero duration, bucket 1: 1 tick, bucket 2: 2-3 ticks, bucket 3: 4-7 ticks...),
+the last bucket counts all longer durations*/
+struct OFSMProfile {
+    uint32_t                count;                      /*handler invocations; 0 - slot is not used*/
+    uint32_t                transitionCount;            /*invocations that ended with transition (not prevented by handler)*/
+    uint32_t                maxDuration;
+    uint32_t                histogram[OFSM_CONFIG_PROFILING_BUCKET_COUNT];
+    OFSM_CONFIG_INDEX_TYPE  groupIndex;
+    OFSM_CONFIG_INDEX_TYPE  fsmIndex;
+    OFSM_CONFIG_INDEX_TYPE  state;                      /*state the handler was called in*/
+    OFSM_CONFIG_INDEX_TYPE  eventCode;
+};
+#endif
+
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+/*binary trace record: 16 bytes, no padding on AVR and on the host; dump is little-endian (see ofsm_trace_dump() and tools/ofsmTraceDecode.cpp).
+Indices and event codes are truncated to 16 bits, time to 32 bits*/
+struct OFSMTraceRecord {
+    uint32_t                time;                       /*ofsm time (ticks) when record was emitted*/
+    uint32_t                value;                      /*record type specific, see _OFSM_TRACE_...*/
+    uint16_t                groupIndex;
+    uint16_t                fsmIndex;
+    uint16_t                code;                       /*record type specific, see _OFSM_TRACE_...*/
+    uint8_t                 type;                       /*_OFSM_TRACE_...*/
+    uint8_t                 flags;                      /*record type specific, see _OFSM_TRACE_...*/
+};
+#endif
+
 /*defined typedef void(*OFSMHandler)(OFSMState *fsmState);*/
 
+/*transition table types*/
+#define _OFSM_TRANSITION_TABLE_TYPE_DENSE   0   /*OFSMTransition table[][transitionTableEventCount]*/
+#define _OFSM_TRANSITION_TABLE_TYPE_COMPACT 1   /*OFSMCompactTransition table[stateCount * transitionTableEventCount], see ofsm.table.h*/
+#define _OFSM_TRANSITION_TABLE_TYPE_SPARSE  2   /*OFSMSparseTransition *table[stateCount], see OFSM_DECLARE_SPARSE_FSM*/
+
+#define OFSM_COMPACT_NOP_HANDLER_INDEX 0xFF
+#define OFSM_SPARSE_TRANSITION_END { (OFSM_CONFIG_INDEX_TYPE)-1, 0, 0 } /*terminates each row of sparse transition table*/
+
 /*------------------------------------------------
 Flags
 -------------------------------------------------*/
 //Common flags
 #define _OFSM_FLAG_INFINITE_SLEEP			0x1
-#define _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW	0x2 /*indicate if wakeup time is scheduled after post overflow of time register*/
+#define _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW	0x2 /*parity of time epoch (see _OFSM_FLAG_OFSM_TIMER_OVERFLOW) wakeup time belongs to*/
 #define _OFSM_FLAG_ALLOW_DEEP_SLEEP         0x4
-#define _OFSM_FLAG_ALL (_OFSM_FLAG_INFINITE_SLEEP | _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW | _OFSM_FLAG_ALLOW_DEEP_SLEEP)
+#ifdef OFSM_CONFIG_WIDE_TIME
+#   define _OFSM_FLAG_ALL (_OFSM_FLAG_INFINITE_SLEEP | _OFSM_FLAG_ALLOW_DEEP_SLEEP)
+#else
+#   define _OFSM_FLAG_ALL (_OFSM_FLAG_INFINITE_SLEEP | _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW | _OFSM_FLAG_ALLOW_DEEP_SLEEP)
+#endif
 
 //FSM Flags
 #define _OFSM_FLAG_FSM_PREVENT_TRANSITION			0x10
@@ -365,7 +702,7 @@ Flags
 //Orchestra Flags
 #define _OFSM_FLAG_OFSM_IN_DEEP_SLEEP   0x8   /*watch dog timer is running*/
 #define _OFSM_FLAG_OFSM_EVENT_QUEUED	0x10
-#define _OFSM_FLAG_OFSM_TIMER_OVERFLOW	0x20
+#define _OFSM_FLAG_OFSM_TIMER_OVERFLOW	0x20  /*parity of time epoch: toggles every time the time wraps*/
 #define _OFSM_FLAG_OFSM_FIRST_ITERATION 0x40 /*allow timeout event while in infinite sleep, when timeout is queued before loop starts*/
 #define _OFSM_FLAG_OFSM_SIMULATION_EXIT	0x80
 #define _OFSM_FLAG_OFSM_IN_PROCESS		0x100
@@ -373,12 +710,67 @@ Flags
 /*------------------------------------------------
 Global variables
 -------------------------------------------------*/
+#ifdef OFSM_CONFIG_MULTI_INSTANCE
+/*runtime state of one ofsm instance (orchestra). Context must be zero initialized (static storage or new OFSMContext()).
+Every thread works with the context bound by ofsm_context_bind() (_ofsmDefaultContext until then), globals below refer to its fields*/
+struct OFSMContext {
+    OFSMGroup**                     groups;
+    OFSM_CONFIG_INDEX_TYPE          groupCount;
+    volatile _OFSM_FLAGS_DATA_TYPE  flags;
+    volatile _OFSM_TIME_DATA_TYPE   wakeupTime;
+    volatile _OFSM_TIME_DATA_TYPE   time;
+#   ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+    volatile _OFSM_PENDING_GROUP_DATA_TYPE* pendingGroups;
+    volatile _OFSM_PENDING_GROUP_DATA_TYPE* simulationPendingGroups; /*allocated by OFSM_SETUP_GROUPS()*/
+    uint32_t                        simulationPendingGroupsSize;
+#   endif
+#   ifdef OFSM_CONFIG_PROFILING
+    OFSMProfile                     profiles[OFSM_CONFIG_PROFILING_SLOT_COUNT];
+    uint32_t                        profileDroppedCount;
+#   endif
+    std::recursive_mutex            simulationMutex;    /*OFSM_CONFIG_ATOMIC_RESTORESTATE*/
+    std::mutex                      sleepMutex;         /*ofsm thread sleeps on sleepCondition, see _ofsm_simulation_enter_sleep()*/
+    std::condition_variable         sleepCondition;
+#   if defined(OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE) || defined(OFSM_CONFIG_SIMULATION_WORK_STEALING)
+    std::atomic<bool>               sleeping;
+#   endif
+};
+
+extern OFSMContext                      _ofsmDefaultContext;
+extern _OFSM_THREAD_LOCAL OFSMContext*  _ofsmContext;
+#   define _ofsmGroups                  (_ofsmContext->groups)
+#   define _ofsmGroupCount              (_ofsmContext->groupCount)
+#   define _ofsmFlags                   (_ofsmContext->flags)
+#   define _ofsmWakeupTime              (_ofsmContext->wakeupTime)
+#   define _ofsmTime                    (_ofsmContext->time)
+#   define _ofsmPendingGroups           (_ofsmContext->pendingGroups)
+#   define _ofsmSimulationPendingGroups (_ofsmContext->simulationPendingGroups)
+#   define _ofsmSimulationPendingGroupsSize (_ofsmContext->simulationPendingGroupsSize)
+#   define _ofsmProfiles                (_ofsmContext->profiles)
+#   define _ofsmProfileDroppedCount     (_ofsmContext->profileDroppedCount)
+#else
 extern OFSMGroup**				        _ofsmGroups;
-extern uint8_t                          _ofsmGroupCount;
-extern OFSMState*						_ofsmCurrentFsmState;
-extern volatile uint16_t                _ofsmFlags;
+extern OFSM_CONFIG_INDEX_TYPE           _ofsmGroupCount;
+extern volatile _OFSM_FLAGS_DATA_TYPE   _ofsmFlags;
 extern volatile _OFSM_TIME_DATA_TYPE    _ofsmWakeupTime;
 extern volatile _OFSM_TIME_DATA_TYPE    _ofsmTime;
+#   ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+extern volatile _OFSM_PENDING_GROUP_DATA_TYPE* _ofsmPendingGroups;
+#       ifdef OFSM_CONFIG_SIMULATION
+extern volatile _OFSM_PENDING_GROUP_DATA_TYPE* _ofsmSimulationPendingGroups;
+extern uint32_t                         _ofsmSimulationPendingGroupsSize;
+#       endif
+#   endif
+#   ifdef OFSM_CONFIG_PROFILING
+extern OFSMProfile                      _ofsmProfiles[OFSM_CONFIG_PROFILING_SLOT_COUNT];
+extern uint32_t                         _ofsmProfileDroppedCount;
+#   endif
+#endif /*OFSM_CONFIG_MULTI_INSTANCE*/
+extern _OFSM_THREAD_LOCAL OFSMState*	_ofsmCurrentFsmState;
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+extern OFSMTraceRecord                  _ofsmTraceBuffer[OFSM_CONFIG_TRACE_BUFFER_SIZE];
+extern _OFSM_TRACE_COUNTER_DATA_TYPE    _ofsmTraceCount;
+#endif
 
 /*------------------------------------------------
 Macros
@@ -416,27 +808,134 @@ Macros
     }
 
 #define ofsm_query_get_group(groupIndex) (_ofsmGroups[groupIndex])
-#define ofsm_query_get_fsm(groupIndex, fsmIndex) ((ofsm_query_get_group(groupIndex)->fsms)[fsmIndex])
+#define ofsm_query_get_fsm(groupIndex, fsmIndex) ((ofsm_query_get_group(groupIndex)->fsms)[fsmIndex]) /*not available for pool groups*/
 
 #define ofsm_query_flags() (_ofsmFlags)
 #define ofsm_query_group_flags(groupIndex) (ofsm_query_get_group(groupIndex)->flags)
-#define ofsm_query_fsm_time_left_before_timeout(groupIndex, fsmIndex) ((ofsm_query_get_fsm(groupIndex, fsmIndex)->wakeupTime == 0 || ofsm_query_get_fsm(groupIndex, fsmIndex)->wakeupTime < _ofsmTime) ? 0 : ofsm_query_get_fsm(groupIndex, fsmIndex)->wakeupTime - _ofsmTime)
-#define ofsm_query_fsm_next_state(groupIndex, fsmIndex) (ofsm_query_get_fsm(groupIndex, fsmIndex)->currentState)
-#define ofsm_query_fsm_flags(groupIndex, fsmIndex) (ofsm_query_get_fsm(groupIndex, fsmIndex)->flags)
+#define ofsm_query_fsm_time_left_before_timeout(groupIndex, fsmIndex) ((_OFSM_GROUP_FSM_FIELD(ofsm_query_get_group(groupIndex), fsmIndex, wakeupTime) == 0 || _OFSM_GROUP_FSM_FIELD(ofsm_query_get_group(groupIndex), fsmIndex, wakeupTime) < _ofsmTime) ? 0 : _OFSM_GROUP_FSM_FIELD(ofsm_query_get_group(groupIndex), fsmIndex, wakeupTime) - _ofsmTime)
+#define ofsm_query_fsm_next_state(groupIndex, fsmIndex) (_OFSM_GROUP_FSM_FIELD(ofsm_query_get_group(groupIndex), fsmIndex, currentState))
+#define ofsm_query_fsm_flags(groupIndex, fsmIndex) (_OFSM_GROUP_FSM_FIELD(ofsm_query_get_group(groupIndex), fsmIndex, flags))
+
+#ifdef OFSM_CONFIG_PROFILING
+/*profile slots are keyed by (group, fsm, state, event); slot is not used if its count is 0. See also ofsm_query_profile_find() and ofsm_profile_reset()*/
+#   define ofsm_query_profile_slot_count() (OFSM_CONFIG_PROFILING_SLOT_COUNT)
+#   define ofsm_query_profile(slotIndex) (&(_ofsmProfiles[slotIndex]))
+#   define ofsm_query_profile_dropped_count() (_ofsmProfileDroppedCount) /*handler invocations that didn't find free slot*/
+#endif
 
-#define _OFSM_GET_TRANSTION(fsm, eventCode) ((OFSMTransition*)( (fsm->transitionTableEventCount * fsm->currentState +  eventCode) * sizeof(OFSMTransition) + (char*)fsm->transitionTable) )
+#ifdef OFSM_CONFIG_MULTI_INSTANCE
+/*all ofsm calls made by the calling thread (setup, loop, queue, heartbeat, query) go to bound context; NULL binds _ofsmDefaultContext.
+Thread that queues events or supplies heartbeat to other thread's instance has to bind the same context first*/
+#   define ofsm_context_bind(context) (_ofsmContext = ((context) ? (context) : &_ofsmDefaultContext))
+#   define ofsm_context_get() (_ofsmContext)
+#   ifndef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
+/*requests OFSM_LOOP() of bound context to return*/
+#       define ofsm_context_exit() \
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) { \
+        _ofsmFlags |= (_OFSM_FLAG_OFSM_SIMULATION_EXIT | _OFSM_FLAG_OFSM_EVENT_QUEUED); \
+        OFSM_CONFIG_CUSTOM_WAKEUP_FUNC(); \
+    }
+#   endif
+#endif
+
+/*fsm of the group: pool instance is loaded into shared fsm of the pool (LOAD) and has to be written back after modification (STORE);
+FIELD reads per instance field (currentState, flags, wakeupTime, skipNextEventCode) without touching shared fsm*/
+#ifdef OFSM_CONFIG_FSM_POOL
+#   define _OFSM_GROUP_FSM_LOAD(group, fsmIndex) _ofsm_group_fsm_load(group, fsmIndex)
+#   define _OFSM_GROUP_FSM_STORE(group, fsmIndex) _ofsm_group_fsm_store(group, fsmIndex)
+#   define _OFSM_GROUP_FSM_FIELD(group, fsmIndex, field) ((group)->pool ? ((group)->pool->field)[fsmIndex] : ((group)->fsms)[fsmIndex]->field)
+#else
+#   define _OFSM_GROUP_FSM_LOAD(group, fsmIndex) (((group)->fsms)[fsmIndex])
+#   define _OFSM_GROUP_FSM_STORE(group, fsmIndex)
+#   define _OFSM_GROUP_FSM_FIELD(group, fsmIndex, field) (((group)->fsms)[fsmIndex]->field)
+#endif
+
+#define _OFSM_GET_STATE_TRANSTION(fsm, state, eventCode) ((OFSMTransition*)( (fsm->transitionTableEventCount * (state) +  (eventCode)) * sizeof(OFSMTransition) + (char*)fsm->transitionTable) )
+#define _OFSM_GET_TRANSTION(fsm, eventCode) _OFSM_GET_STATE_TRANSTION(fsm, fsm->currentState, eventCode)
+
+/*group dispatch: process event by fsm; with run to completion, zero delay timeouts are processed in place*/
+#ifdef OFSM_CONFIG_RUN_TO_COMPLETION_DEPTH
+#   define _OFSM_FSM_PROCESS_EVENT(fsm, groupIndex, fsmIndex, e) _ofsm_fsm_run_to_completion(fsm, groupIndex, fsmIndex, e)
+#else
+#   define _OFSM_FSM_PROCESS_EVENT(fsm, groupIndex, fsmIndex, e) _ofsm_fsm_process_event(fsm, groupIndex, fsmIndex, e)
+#endif
+
+/*event interest mask: skip fsm without calling it, unless current state has a handler for the event or the event is set to be skipped (skip has to be reset)*/
+#ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+#   define _OFSM_EVENT_INTEREST_MASK_STRIDE(fsm) (((fsm)->transitionTableEventCount + 7) >> 3)
+#   define _OFSM_FSM_ACCEPTS_EVENT(fsm, eventCode) ( \
+        !(fsm)->eventInterestMask /*run time fsm without state count, see OFSM_SETUP_GROUPS()*/ \
+        || ((eventCode) < (fsm)->transitionTableEventCount \
+            && ((fsm)->eventInterestMask[(unsigned long)(fsm)->currentState * _OFSM_EVENT_INTEREST_MASK_STRIDE(fsm) + ((eventCode) >> 3)] & (1 << ((eventCode) & 7)))) \
+        || (eventCode) == (fsm)->skipNextEventCode )
+#else
+#   define _OFSM_FSM_ACCEPTS_EVENT(fsm, eventCode) 1
+#endif
 
 /*time comparison*/
 /*ao, bo - 'o' means overflow*/
-#define _OFSM_TIME_A_GT_B(a, ao, b, bo)  ( (a  >  b) && (ao || !bo) )
-#define _OFSM_TIME_A_GTE_B(a, ao, b, bo) ( (a  >=  b) && (ao || !bo) )
+#ifdef OFSM_CONFIG_WIDE_TIME
+/*wide time never overflows: overflow flags are ignored (they are side effect free, so compiler drops them)*/
+#   define _OFSM_TIME_A_GT_B(a, ao, b, bo)  ( (void)(ao), (void)(bo), (a) > (b) )
+#   define _OFSM_TIME_A_GTE_B(a, ao, b, bo) ( (void)(ao), (void)(bo), (a) >= (b) )
+#   define _OFSM_TIME_KEY_A_LT_B(a, ao, b, bo) ( (void)(ao), (void)(bo), (a) < (b) )
+#else
+/*overflow flags are epoch parities: times of the same epoch compare as they are, time of the other epoch is later when it is smaller
+(it is either past the next wrap or before the last one). Holds while compared times are less than a full wrap apart*/
+#   define _OFSM_TIME_A_GT_B(a, ao, b, bo)  ( (!(ao) == !(bo)) ? ((a) > (b)) : ((a) < (b)) )
+#   define _OFSM_TIME_A_GTE_B(a, ao, b, bo) ( (!(ao) == !(bo)) ? ((a) >= (b)) : ((a) < (b)) )
+/*strict ordering used by wakeup index*/
+#   define _OFSM_TIME_KEY_A_LT_B(a, ao, b, bo) ( (!(ao) == !(bo)) ? ((a) < (b)) : ((a) > (b)) )
+#endif /*OFSM_CONFIG_WIDE_TIME*/
+
+/*fold wakeup time w (flags wf) of fsm into earliest wakeup time e (flags ef) of group/ofsm.
+Flags are anded, except for scheduled time overflow: it is the one of e. e is taken as is while all folded fsms are in infinite sleep*/
+#define _OFSM_WAKEUP_FOLD(e, ef, w, wf) \
+    do { \
+        if (!((wf) & _OFSM_FLAG_INFINITE_SLEEP) \
+            && (((ef) & _OFSM_FLAG_INFINITE_SLEEP) || _OFSM_TIME_A_GT_B((e), ((ef) & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW), (w), ((wf) & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW)))) { \
+            (e) = (w); \
+            (ef) = (uint8_t)(((ef) & ~_OFSM_FLAG_SCHEDULED_TIME_OVERFLOW) | ((wf) & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW)); \
+        } \
+        (ef) &= (uint8_t)((wf) | _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW); \
+    } while (0)
+
+/*pending group bitmap: bit per group that has queued event(s) or needs its wakeup summary to be (re)calculated*/
+#ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+#   define _OFSM_PENDING_GROUP_SET(groupIndex) (_ofsmPendingGroups[(groupIndex) >> 3] |= (uint8_t)(1 << ((groupIndex) & 7)))
+#   define _OFSM_PENDING_GROUP_CLEAR(groupIndex) (_ofsmPendingGroups[(groupIndex) >> 3] &= (uint8_t)~(1 << ((groupIndex) & 7)))
+#   define _OFSM_PENDING_GROUP_IS_SET(groupIndex) (_ofsmPendingGroups[(groupIndex) >> 3] & (1 << ((groupIndex) & 7)))
+#endif
+
+/*lock-free event queue*/
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+#   define _OFSM_LOCK_FREE_QUEUE_CELL_LOCK(group, cell) \
+        while ((group->eventQueueCellLock)[cell].exchange(1, std::memory_order_acquire)) { \
+            std::this_thread::yield(); \
+        }
+#   define _OFSM_LOCK_FREE_QUEUE_CELL_UNLOCK(group, cell) ((group->eventQueueCellLock)[cell].store(0, std::memory_order_release))
+#   define _OFSM_GROUP_IS_BUFFER_OVERFLOW(group) (_ofsm_simulation_lock_free_queue_pending_count(group) >= (group)->eventQueueSize)
+#else
+#   define _OFSM_GROUP_IS_BUFFER_OVERFLOW(group) ((group)->flags & _OFSM_FLAG_GROUP_BUFFER_OVERFLOW)
+#endif
 
 /*----------------------------------------------
 Setup helper macros
 -----------------------------------------------*/
 
 #define _OFSM_DECLARE_GET(name, id) (name##id)
-#define _OFSM_DECLARE_GROUP_EVENT_QUEUE(grpId, eventQueueSize) OFSMEventData _ofsm_decl_grp_eq_##grpId[eventQueueSize];
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+#   define _OFSM_DECLARE_GROUP_EVENT_QUEUE(grpId, eventQueueSize) \
+        OFSMEventData _ofsm_decl_grp_eq_##grpId[eventQueueSize]; \
+        std::atomic<uint64_t> _ofsm_decl_grp_eqs_##grpId[eventQueueSize]; \
+        std::atomic<uint8_t> _ofsm_decl_grp_eql_##grpId[eventQueueSize];
+#   define _OFSM_DECLARE_GROUP_LOCK_FREE_QUEUE_INIT(grpId) \
+        ,_OFSM_DECLARE_GET(_ofsm_decl_grp_eqs_, grpId) \
+        ,_OFSM_DECLARE_GET(_ofsm_decl_grp_eql_, grpId)
+#else
+#   define _OFSM_DECLARE_GROUP_EVENT_QUEUE(grpId, eventQueueSize) OFSMEventData _ofsm_decl_grp_eq_##grpId[eventQueueSize];
+#   define _OFSM_DECLARE_GROUP_LOCK_FREE_QUEUE_INIT(grpId)
+#endif
 
 #define _OFSM_DECLARE_GROUP_FSM_ARRAY_1(grpId, fsmId0) OFSM *_ofsm_decl_grp_fsms_##grpId[] = { &_ofsm_decl_fsm_##fsmId0 };
 #define _OFSM_DECLARE_GROUP_FSM_ARRAY_2(grpId, fsmId0, fsmId1) OFSM *_ofsm_decl_grp_fsms_##grpId[] = { &_ofsm_decl_fsm_##fsmId0, &_ofsm_decl_fsm_##fsmId1 };
@@ -444,12 +943,50 @@ Setup helper macros
 #define _OFSM_DECLARE_GROUP_FSM_ARRAY_4(grpId, fsmId0, fsmId1, fsmId2, fsmId3) OFSM *_ofsm_decl_grp_fsms_##grpId[] = { &_ofsm_decl_fsm_##fsmId0, &_ofsm_decl_fsm_##fsmId1, &_ofsm_decl_fsm_##fsmId2, &_ofsm_decl_fsm_##fsmId3 };
 #define _OFSM_DECLARE_GROUP_FSM_ARRAY_5(grpId, fsmId0, fsmId1, fsmId2, fsmId3, fsmId4) OFSM *_ofsm_decl_grp_fsms_##grpId[] = { &_ofsm_decl_fsm_##fsmId0, &_ofsm_decl_fsm_##fsmId1, &_ofsm_decl_fsm_##fsmId2, &_ofsm_decl_fsm_##fsmId3, &_ofsm_decl_fsm_##fsmId4 };
 
+#define _OFSM_DECLARE_GROUP_SIZE(grpId) (sizeof(_OFSM_DECLARE_GET(_ofsm_decl_grp_fsms_, grpId))/sizeof(*_OFSM_DECLARE_GET(_ofsm_decl_grp_fsms_, grpId)))
+
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+#   define _OFSM_DECLARE_GROUP_WAKEUP_INDEX(grpId) \
+        OFSM_CONFIG_INDEX_TYPE _ofsm_decl_grp_wih_##grpId[_OFSM_DECLARE_GROUP_SIZE(grpId)]; \
+        OFSM_CONFIG_INDEX_TYPE _ofsm_decl_grp_wip_##grpId[_OFSM_DECLARE_GROUP_SIZE(grpId)]; \
+        uint8_t _ofsm_decl_grp_wif_##grpId[_OFSM_DECLARE_GROUP_SIZE(grpId)];
+#   define _OFSM_DECLARE_GROUP_WAKEUP_INDEX_INIT(grpId) \
+        ,_OFSM_DECLARE_GET(_ofsm_decl_grp_wih_, grpId) \
+        ,_OFSM_DECLARE_GET(_ofsm_decl_grp_wip_, grpId) \
+        ,_OFSM_DECLARE_GET(_ofsm_decl_grp_wif_, grpId) \
+        ,0, 0 /*wakeupIndexSize, wakeupIndexNoDeepSleepCount*/
+/*pool group streams through contiguous wakeup times of its instances instead*/
+#   define _OFSM_DECLARE_GROUP_NO_WAKEUP_INDEX_INIT() ,NULL, NULL, NULL, 0, 0
+#else
+#   define _OFSM_DECLARE_GROUP_WAKEUP_INDEX(grpId)
+#   define _OFSM_DECLARE_GROUP_WAKEUP_INDEX_INIT(grpId)
+#   define _OFSM_DECLARE_GROUP_NO_WAKEUP_INDEX_INIT()
+#endif /*OFSM_CONFIG_WAKEUP_INDEX*/
+
+#ifdef _OFSM_GROUP_SUMMARY_CACHE
+#   define _OFSM_DECLARE_GROUP_SUMMARY_CACHE_INIT() ,0, 0 /*earliestWakeupTime, andedFsmFlags*/
+#else
+#   define _OFSM_DECLARE_GROUP_SUMMARY_CACHE_INIT()
+#endif
+
+#ifdef OFSM_CONFIG_FSM_POOL
+#   define _OFSM_DECLARE_GROUP_POOL_INIT(poolPtr) ,poolPtr
+#else
+#   define _OFSM_DECLARE_GROUP_POOL_INIT(poolPtr)
+#endif
+
 #define _OFSM_DECLARE_GROUP(grpId) \
+    _OFSM_DECLARE_GROUP_WAKEUP_INDEX(grpId) \
     OFSMGroup _ofsm_decl_grp_##grpId = {\
         _OFSM_DECLARE_GET(_ofsm_decl_grp_fsms_, grpId),\
-        sizeof(_OFSM_DECLARE_GET(_ofsm_decl_grp_fsms_, grpId))/sizeof(*_OFSM_DECLARE_GET(_ofsm_decl_grp_fsms_, grpId)),\
+        _OFSM_DECLARE_GROUP_SIZE(grpId),\
         _OFSM_DECLARE_GET(_ofsm_decl_grp_eq_, grpId),\
-        sizeof(_OFSM_DECLARE_GET(_ofsm_decl_grp_eq_, grpId))/sizeof(*_OFSM_DECLARE_GET(_ofsm_decl_grp_eq_, grpId))\
+        sizeof(_OFSM_DECLARE_GET(_ofsm_decl_grp_eq_, grpId))/sizeof(*_OFSM_DECLARE_GET(_ofsm_decl_grp_eq_, grpId)),\
+        0, 0, 0 /*flags, nextEventIndex, currentEventIndex*/\
+        _OFSM_DECLARE_GROUP_WAKEUP_INDEX_INIT(grpId)\
+        _OFSM_DECLARE_GROUP_SUMMARY_CACHE_INIT()\
+        _OFSM_DECLARE_GROUP_POOL_INIT(NULL)\
+        _OFSM_DECLARE_GROUP_LOCK_FREE_QUEUE_INIT(grpId)\
     }
 
 #define _OFSM_DECLARE_GROUP_ARRAY_1(grpId0) OFSMGroup *_ofsm_decl_grp_arr[] = { &_OFSM_DECLARE_GET(_ofsm_decl_grp_, grpId0) };
@@ -464,68 +1001,125 @@ Setup helper macros
     _OFSM_DECLARE_GROUP_FSM_ARRAY_##n(grpId, __VA_ARGS__);\
     _OFSM_DECLARE_GROUP(grpId);
 
+#ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+#   define _OFSM_DECLARE_PENDING_GROUP_BITMAP(n) volatile _OFSM_PENDING_GROUP_DATA_TYPE _ofsm_decl_grp_pending[((n) + 7) >> 3];
+#   define _OFSM_SETUP_PENDING_GROUP_BITMAP() _ofsmPendingGroups = _ofsm_decl_grp_pending;
+#else
+#   define _OFSM_DECLARE_PENDING_GROUP_BITMAP(n)
+#   define _OFSM_SETUP_PENDING_GROUP_BITMAP()
+#endif
+
 #define _OFSM_DECLARE_N(n, ...)\
-    _OFSM_DECLARE_GROUP_ARRAY_##n(__VA_ARGS__);
+    _OFSM_DECLARE_GROUP_ARRAY_##n(__VA_ARGS__);\
+    _OFSM_DECLARE_PENDING_GROUP_BITMAP(n)
+
+#ifdef OFSM_CONFIG_SUPPORT_INITIALIZATION_HANDLER
+#   define _OFSM_DECLARE_FSM_INIT_HANDLER(initializationHandler) initializationHandler, /*initHandler*/
+#else
+#   define _OFSM_DECLARE_FSM_INIT_HANDLER(initializationHandler)
+#endif
 
 #ifdef OFSM_CONFIG_SIMULATION
-#   ifdef OFSM_CONFIG_SUPPORT_INITIALIZATION_HANDLER
-#       define OFSM_DECLARE_FSM(fsmId, transitionTable, transitionTableEventCount, initializationHandler, fsmPrivateDataPtr, initialState) \
-        OFSM _ofsm_decl_fsm_##fsmId = {\
-                (OFSMTransition**)transitionTable, 	/*transitionTable*/ \
-                transitionTableEventCount,			/*transitionTableEventCount*/ \
-                fsmPrivateDataPtr,					/*fsmPrivateInfo*/ \
-                _OFSM_FLAG_INFINITE_SLEEP,          /*flags*/ \
-                0,                                  /*wakeup time*/ \
-                initialState,                       /*initial state*/ \
-                (uint8_t)-1,                        /*skipNextEventCode*/ \
-                initializationHandler,				/*initHandler*/ \
-                initialState                        /*simulation initial state*/ \
-        };
-#   else
-#       define OFSM_DECLARE_FSM(fsmId, transitionTable, transitionTableEventCount, initializationHandler, fsmPrivateDataPtr, initialState) \
-        OFSM _ofsm_decl_fsm_##fsmId = {\
-                (OFSMTransition**)transitionTable, 	/*transitionTable*/ \
-                transitionTableEventCount,			/*transitionTableEventCount*/ \
-                fsmPrivateDataPtr,					/*fsmPrivateInfo*/ \
-                _OFSM_FLAG_INFINITE_SLEEP,          /*flags*/ \
-                0,                                  /*wakeup time*/ \
-                initialState,                       /*current state*/ \
-                (uint8_t)-1,                        /*skipNextEventCode*/ \
-                initialState                        /*simulation initial state*/ \
-        };
-#   endif
+#   define _OFSM_DECLARE_FSM_SIMULATION_INITIAL_STATE(initialState) initialState, /*simulation initial state*/
 #else
-#   ifdef OFSM_CONFIG_SUPPORT_INITIALIZATION_HANDLER
-#       define OFSM_DECLARE_FSM(fsmId, transitionTable, transitionTableEventCount, initializationHandler, fsmPrivateDataPtr, initialState) \
-        OFSM _ofsm_decl_fsm_##fsmId = {\
-                (OFSMTransition**)transitionTable, 	/*transitionTable*/ \
-                transitionTableEventCount,			/*transitionTableEventCount*/ \
-                fsmPrivateDataPtr,					/*fsmPrivateInfo*/ \
-                _OFSM_FLAG_INFINITE_SLEEP,          /*flags*/ \
-                0,                                  /*wakeup time*/ \
-                initialState,                       /*current state*/ \
-                (uint8_t)-1                         /*skipNextEventCode*/ \
-                initializationHandler,				/*initHandler*/ \
-        };
-#   else
-#       define OFSM_DECLARE_FSM(fsmId, transitionTable, transitionTableEventCount, initializationHandler, fsmPrivateDataPtr, initialState) \
-        OFSM _ofsm_decl_fsm_##fsmId = {\
-                (OFSMTransition**)transitionTable, 	/*transitionTable*/ \
-                transitionTableEventCount,			/*transitionTableEventCount*/ \
-                fsmPrivateDataPtr,					/*fsmPrivateInfo*/ \
-                _OFSM_FLAG_INFINITE_SLEEP,          /*flags*/ \
-                0,                                  /*wakeup time*/ \
-                initialState,                       /*current state*/ \
-                (uint8_t)-1                         /*skipNextEventCode*/ \
-        };
-#   endif
-#endif /* OFSM_CONFIG_SIMULATION*/
+#   define _OFSM_DECLARE_FSM_SIMULATION_INITIAL_STATE(initialState)
+#endif
+
+#define _OFSM_DECLARE_FSM_STATE_COUNT(transitionTable) (sizeof(transitionTable)/sizeof(*transitionTable))
+
+#ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+#   define _OFSM_DECLARE_FSM_EVENT_INTEREST_MASK(fsmId, stateCount, transitionTableEventCount) \
+        uint8_t _ofsm_decl_fsm_eim_##fsmId[(stateCount) * (((transitionTableEventCount) + 7) >> 3)];
+#   define _OFSM_DECLARE_FSM_EVENT_INTEREST_MASK_INIT(fsmId, stateCount) \
+        _ofsm_decl_fsm_eim_##fsmId,                         /*eventInterestMask*/ \
+        stateCount,                                         /*transitionTableStateCount*/
+#else
+#   define _OFSM_DECLARE_FSM_EVENT_INTEREST_MASK(fsmId, stateCount, transitionTableEventCount)
+#   define _OFSM_DECLARE_FSM_EVENT_INTEREST_MASK_INIT(fsmId, stateCount)
+#endif /*OFSM_CONFIG_EVENT_INTEREST_MASK*/
+
+#ifdef OFSM_CONFIG_COMPACT_TRANSITION_TABLE
+#   define _OFSM_DECLARE_FSM_TRANSITION_HANDLERS_INIT(transitionHandlers) transitionHandlers, /*transitionHandlers*/
+#else
+#   define _OFSM_DECLARE_FSM_TRANSITION_HANDLERS_INIT(transitionHandlers)
+#endif /*OFSM_CONFIG_COMPACT_TRANSITION_TABLE*/
+
+#ifdef _OFSM_TRANSITION_TABLE_TYPES
+#   define _OFSM_DECLARE_FSM_TRANSITION_TABLE_TYPE_INIT(transitionTableType, transitionHandlers) \
+        transitionTableType,                                /*transitionTableType*/ \
+        _OFSM_DECLARE_FSM_TRANSITION_HANDLERS_INIT(transitionHandlers)
+#else
+#   define _OFSM_DECLARE_FSM_TRANSITION_TABLE_TYPE_INIT(transitionTableType, transitionHandlers)
+#endif /*_OFSM_TRANSITION_TABLE_TYPES*/
+
+#define _OFSM_DECLARE_FSM(fsmId, transitionTablePtr, stateCount, transitionTableEventCount, transitionTableType, transitionHandlers, initializationHandler, fsmPrivateDataPtr, initialState) \
+    _OFSM_DECLARE_FSM_EVENT_INTEREST_MASK(fsmId, stateCount, transitionTableEventCount) \
+    OFSM _ofsm_decl_fsm_##fsmId = {\
+            (OFSMTransition**)transitionTablePtr, /*transitionTable*/ \
+            transitionTableEventCount,			/*transitionTableEventCount*/ \
+            fsmPrivateDataPtr,					/*fsmPrivateInfo*/ \
+            _OFSM_FLAG_INFINITE_SLEEP,          /*flags*/ \
+            0,                                  /*wakeup time*/ \
+            initialState,                       /*current state*/ \
+            (OFSM_CONFIG_INDEX_TYPE)-1,         /*skipNextEventCode*/ \
+            _OFSM_DECLARE_FSM_INIT_HANDLER(initializationHandler) \
+            _OFSM_DECLARE_FSM_SIMULATION_INITIAL_STATE(initialState) \
+            _OFSM_DECLARE_FSM_EVENT_INTEREST_MASK_INIT(fsmId, stateCount) \
+            _OFSM_DECLARE_FSM_TRANSITION_TABLE_TYPE_INIT(transitionTableType, transitionHandlers) \
+    };
+
+#define OFSM_DECLARE_FSM(fsmId, transitionTable, transitionTableEventCount, initializationHandler, fsmPrivateDataPtr, initialState) \
+    _OFSM_DECLARE_FSM(fsmId, transitionTable, _OFSM_DECLARE_FSM_STATE_COUNT(transitionTable), transitionTableEventCount, \
+        _OFSM_TRANSITION_TABLE_TYPE_DENSE, NULL, initializationHandler, fsmPrivateDataPtr, initialState)
+
+/*sparse transition table: array of rows (one per state), each row lists handled events sorted by event code and ends with OFSM_SPARSE_TRANSITION_END.
+Example:
+    OFSMSparseTransition s0Row[] = { { Timeout, TimeoutHandler, S1 }, { Button, ButtonHandler, S0 }, OFSM_SPARSE_TRANSITION_END };
+    OFSMSparseTransition s1Row[] = { { Button, ButtonHandler, S0 }, OFSM_SPARSE_TRANSITION_END };
+    OFSMSparseTransition *sparseTable[] = { s0Row, s1Row };
+    OFSM_DECLARE_SPARSE_FSM(fsmId, sparseTable, EventCount, NULL, NULL, S0);
+*/
+#ifdef OFSM_CONFIG_SPARSE_TRANSITION_TABLE
+#   define OFSM_DECLARE_SPARSE_FSM(fsmId, sparseTransitionTable, transitionTableEventCount, initializationHandler, fsmPrivateDataPtr, initialState) \
+        _OFSM_DECLARE_FSM(fsmId, sparseTransitionTable, _OFSM_DECLARE_FSM_STATE_COUNT(sparseTransitionTable), transitionTableEventCount, \
+            _OFSM_TRANSITION_TABLE_TYPE_SPARSE, NULL, initializationHandler, fsmPrivateDataPtr, initialState)
+#endif
+
 #define OFSM_DECLARE_GROUP_1(grpId, eventQueueSize, fsmId0) _OFSM_DECLARE_GROUP_N(1, grpId, eventQueueSize, fsmId0);
 #define OFSM_DECLARE_GROUP_2(grpId, eventQueueSize, fsmId0, fsmId1) _OFSM_DECLARE_GROUP_N(2, grpId, eventQueueSize, fsmId0, fsmId1);
 #define OFSM_DECLARE_GROUP_3(grpId, eventQueueSize, fsmId0, fsmId1, fsmId2) _OFSM_DECLARE_GROUP_N(3, grpId, eventQueueSize, fsmId0, fsmId1, fsmId2);
 #define OFSM_DECLARE_GROUP_4(grpId, eventQueueSize, fsmId0, fsmId1, fsmId2, fsmId3) _OFSM_DECLARE_GROUP_N(4, grpId, eventQueueSize, fsmId0, fsmId1, fsmId2, fsmId3);
 #define OFSM_DECLARE_GROUP_5(grpId, eventQueueSize, fsmId0, fsmId1, fsmId2, fsmId3, fsmId4) _OFSM_DECLARE_GROUP_N(5, grpId, eventQueueSize, fsmId0, fsmId1, fsmId2, fsmId3, fsmId4);
 
+/*pool group: instanceCount copies of fsm that share transition table (see OFSMPool); instance index is fsm index within the group.
+Pool group is passed to OFSM_DECLARE_... as any other group.
+Example:
+    OFSM_DECLARE_FSM_POOL(0, 10, 1000, crosswalkTransitionTable, EventCount, NULL, crosswalkData, Red);
+    OFSM_DECLARE_1(0);
+*/
+#ifdef OFSM_CONFIG_FSM_POOL
+#   define OFSM_DECLARE_FSM_POOL(grpId, eventQueueSize, instanceCount, transitionTable, transitionTableEventCount, initializationHandler, fsmPrivateDataPtr, initialState) \
+        OFSM_DECLARE_FSM(pool_##grpId, transitionTable, transitionTableEventCount, initializationHandler, fsmPrivateDataPtr, initialState) \
+        OFSM_CONFIG_INDEX_TYPE _ofsm_decl_pool_cs_##grpId[instanceCount]; \
+        uint8_t _ofsm_decl_pool_fl_##grpId[instanceCount]; \
+        _OFSM_TIME_DATA_TYPE _ofsm_decl_pool_wt_##grpId[instanceCount]; \
+        OFSM_CONFIG_INDEX_TYPE _ofsm_decl_pool_sk_##grpId[instanceCount]; \
+        OFSMPool _ofsm_decl_pool_##grpId = { &_ofsm_decl_fsm_pool_##grpId, initialState, \
+            _ofsm_decl_pool_cs_##grpId, _ofsm_decl_pool_fl_##grpId, _ofsm_decl_pool_wt_##grpId, _ofsm_decl_pool_sk_##grpId }; \
+        _OFSM_DECLARE_GROUP_EVENT_QUEUE(grpId, eventQueueSize) \
+        OFSMGroup _ofsm_decl_grp_##grpId = {\
+            NULL, /*fsms*/\
+            instanceCount,\
+            _OFSM_DECLARE_GET(_ofsm_decl_grp_eq_, grpId),\
+            sizeof(_OFSM_DECLARE_GET(_ofsm_decl_grp_eq_, grpId))/sizeof(*_OFSM_DECLARE_GET(_ofsm_decl_grp_eq_, grpId)),\
+            0, 0, 0 /*flags, nextEventIndex, currentEventIndex*/\
+            _OFSM_DECLARE_GROUP_NO_WAKEUP_INDEX_INIT()\
+            _OFSM_DECLARE_GROUP_SUMMARY_CACHE_INIT()\
+            _OFSM_DECLARE_GROUP_POOL_INIT(&_ofsm_decl_pool_##grpId)\
+            _OFSM_DECLARE_GROUP_LOCK_FREE_QUEUE_INIT(grpId)\
+        }
+#endif
+
 #define OFSM_DECLARE_1(grpId0) _OFSM_DECLARE_N(1, grpId0);
 #define OFSM_DECLARE_2(grpId0, grpId1) _OFSM_DECLARE_N(2, grpId0, grpId1);
 #define OFSM_DECLARE_3(grpId0, grpId1, grpId2) _OFSM_DECLARE_N(3, grpId0, grpId1, grpId2);
@@ -537,12 +1131,33 @@ Setup helper macros
     OFSM_DECLARE_GROUP_1(0, 10, 0); \
     OFSM_DECLARE_1(0);
 
-#define OFSM_SETUP() \
-    _ofsmGroups = (OFSMGroup**)_ofsm_decl_grp_arr; \
-    _ofsmGroupCount = sizeof(_ofsm_decl_grp_arr) / sizeof(*_ofsm_decl_grp_arr); \
+#define _OFSM_SETUP(groups, groupCount) \
+    _ofsmGroups = (OFSMGroup**)(groups); \
+    _ofsmGroupCount = (groupCount); \
     _ofsmFlags |= (_OFSM_FLAG_INFINITE_SLEEP | _OFSM_FLAG_OFSM_FIRST_ITERATION);\
     _ofsmTime = 0; \
     _ofsm_setup();
+
+#define OFSM_SETUP() \
+    _OFSM_SETUP_PENDING_GROUP_BITMAP() \
+    _OFSM_SETUP(_ofsm_decl_grp_arr, sizeof(_ofsm_decl_grp_arr) / sizeof(*_ofsm_decl_grp_arr))
+
+/*groups built at run time instead of OFSM_DECLARE_... macros (e.g. host model of whole installation with thousands of fsms).
+groups - OFSMGroup*[groupCount]; caller initializes every group (fsms, groupSize, eventQueue, eventQueueSize, pool and pool->fsm of pool group)
+and every fsm the way OFSM_DECLARE_FSM does, including transitionTableStateCount when OFSM_CONFIG_EVENT_INTEREST_MASK is defined.
+Arrays of enabled options that are left NULL are allocated by setup: wakeup index arrays, event interest masks (fsm without state count
+accepts every event), lock-free queue cells (eventQueueSequence, eventQueueCellLock) and per instance arrays of pool groups.
+Setup can be called again with other (or more) groups*/
+#ifdef OFSM_CONFIG_SIMULATION
+#   ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+#       define _OFSM_SETUP_RUNTIME_PENDING_GROUP_BITMAP(groupCount) _ofsm_simulation_setup_pending_group_bitmap(groupCount);
+#   else
+#       define _OFSM_SETUP_RUNTIME_PENDING_GROUP_BITMAP(groupCount)
+#   endif
+#   define OFSM_SETUP_GROUPS(groups, groupCount) \
+        _OFSM_SETUP_RUNTIME_PENDING_GROUP_BITMAP(groupCount) \
+        _OFSM_SETUP(groups, groupCount)
+#endif
 #define OFSM_LOOP() _ofsm_start();
 
 #endif /*__OFSM_DECL_H_*/
@@ -43,6 +43,7 @@ Important design decisions and usage notes:
   Thus, if rules (stated in this section) are followed. The same implementation can run with different speeds and environments.
 * As outcome of previous statement, it is recommended that event handlers rely on relative time (in ticks) supplied by OFSM (or in worse case on ofsm_get_time());
 * It is recommended that handlers never do a time math on their own, and rely completely on relative delays. As time math should account for timer overflow to work in all cases.
+* Time wraps (unless OFSM_CONFIG_WIDE_TIME is defined), delays are expected to be shorter than a full wrap of time.
 * Event handlers are not expected to know transition states, and should rely on events to move FSM. (see Handlers API for details);
 * FSMs can be organized into groups of dependent state machines. NOTE: One group shares the same set of events. Each queued event processed by all FSMs within the group;
 * Events are never directly processed but queued, allowing better parallelism between multiple FSM.
@@ -83,6 +84,8 @@ OFSMTransition transitionTable1[][1 + E3] = {
     ...
     OFSM_DECLARE_5(grpId0,....grpId4) //OFSM with 5 groups
     OFSM_DECLARE_BASIC(transitionTable, transitionTableEventCount, initializationHandler, fsmPrivateDataPtr) //single FSM single Group declaration
+    OFSM_DECLARE_FSM_POOL(grpId, eventQueueSize, instanceCount, transitionTable, transitionTableEventCount, initializationHandler, fsmPrivateDataPtr, initialState) //group of identical FSMs (requires OFSM_CONFIG_FSM_POOL)
+    OFSM_SETUP_GROUPS(groups, groupCount) //simulation only: use instead of OFSM_SETUP() for groups built at run time (OFSMGroup*[groupCount])
 
 IMPORTANT:
 * When handler calls either of fsm_set_transition_delay... or fsm_set_infinite_delay...,
@@ -128,7 +131,7 @@ The following set of functions can be called from any event handler:
 * fsm_set_transition_delay_deep_sleep(unsigned long delayTicks)
 * fsm_set_infinite_delay()
 * fsm_set_infinite_delay_deep_sleep()
-* fsm_set_next_state(uint8_t nextStateId)            //TRY TO AVOID IT! overrides default transition state from the handler
+* fsm_set_next_state(OFSM_CONFIG_INDEX_TYPE nextStateId)            //TRY TO AVOID IT! overrides default transition state from the handler
 
 * fsm_get_private_data()
 * fsm_get_private_data_cast(castType)                // example: MyPrivateStruct_t *data = fsm_get_private_data_cast(fsm, MyPrivateStruct_t*)
@@ -139,10 +142,10 @@ The following set of functions can be called from any event handler:
 * fsm_get_event_code()
 * fsm_get_event_data()
 
-* fsm_queue_group_event(uint8_t eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData) //queue event into current group
-* fsm_queue_group_event_exclude_self(uint8_t eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData) //queue event into current group, but exclude current FSM from handling the queued event
+* fsm_queue_group_event(OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData) //queue event into current group
+* fsm_queue_group_event_exclude_self(OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData) //queue event into current group, but exclude current FSM from handling the queued event
 
-* ofsm_queue_global_event(uint8_t eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData)
+* ofsm_queue_global_event(OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData)
 * ofsm_debug_printf(level,format, ....)	                       //Simulation mode debug print
 
 CONFIGURATION
@@ -150,6 +153,8 @@ CONFIGURATION
 OFSM can be "shaped" in many different ways using configuration switches. NOTE: all needed configuration switches must be defined before #include <ofsm.h> (<ofsm.decl.h>):
 #define OFSM_CONFIG_DEFAULT_STATE_TRANSITION_DELAY              //Default 0. Specifies default transition delay, used if event handler didn't set one.
 #define OFSM_CONFIG_EVENT_DATA_TYPE uint8_t                     //Default uint8_t (8 bits). Event data type.
+#define OFSM_CONFIG_INDEX_TYPE uint8_t                          //Default uint8_t (8 bits). Type of event codes, states, group count, group size, group/fsm indices and event queue size/indices.
+                                                                // Unsigned type up to 32 bits (e.g. uint16_t, uint32_t) lifts the limit of 255 for host models of large installations (see OFSM_SETUP_GROUPS()).
 #define OFSM_CONFIG_ATOMIC_BLOCK ATOMIC_BLOCK                   //Default: ATOMIC_BLOCK; Retain compatibility with original: see implementation details in <util/atomic.h> from AVR SDK.
 #define OFSM_CONFIG_ATOMIC_RESTORESTATE ATOMIC_RESTORESTATE     //Default: ATOMIC_RESTORESTATE see <util/atomic.h>
 #define OFSM_CONFIG_SUPPORT_INITIALIZATION_HANDLER              //Default: undefined. When defined OFMS implements supports for initialization handlers. This will consume a little bit of memory, as handler place holder and initialization logic will be implemented.
@@ -158,6 +163,54 @@ OFSM can be "shaped" in many different ways using configuration switches. NOTE:
 #define OFSM_CONFIG_DISABLE_BROWN_OUT_DETECTOR_ON_IDLE_SLEEP    //Default: undefined.
 #define OFSM_CONFIG_DISABLE_BROWN_OUT_DETECTOR_ON_DEEP_SLEEP    //Default: undefined.
 #define OFSM_CONFIG_QUERY_API_ENABLED                           //Default: undefined. When defined, ofsm_query_.... get implemented.
+#define OFSM_CONFIG_WAKEUP_INDEX                                //Default: undefined. When defined, each group keeps its FSMs in a binary min-heap ordered by wakeup time.
+                                                                // FSM gets re-keyed only when it makes a transition, so that finding of the earliest wakeup time costs O(1) instead of walking all FSMs on every loop.
+                                                                // Consumes 3 bytes of RAM per FSM. NOTE: FSM must not be shared between groups when enabled. Pool groups (OFSM_CONFIG_FSM_POOL) are not indexed.
+#define OFSM_CONFIG_EVENT_INTEREST_MASK                         //Default: undefined. When defined, per state bitmask of handled events is built for every FSM during OFSM_SETUP().
+                                                                // Group skips FSMs that have no handler for the event in the current state without calling into them.
+                                                                // Consumes states * ((events + 7) / 8) bytes of RAM per FSM.
+#define OFSM_CONFIG_PENDING_GROUP_BITMAP                        //Default: undefined. When defined, queuing of an event marks the group in a pending group bitmap and main loop visits only marked groups.
+                                                                // Other groups keep their cached wakeup summary, which gets merged once all queues are drained.
+                                                                // NOTE: FSM must not be shared between groups when enabled.
+#define OFSM_CONFIG_EVENT_BATCH_SIZE 4                          //Default: undefined. When defined, up to specified number of events is taken out of group queue within single atomic block.
+                                                                // Events are dispatched back-to-back (each event to all group FSMs before the next one) and group wakeup summary is collected once per batch.
+                                                                // Batch is copied onto the stack: OFSM_CONFIG_EVENT_BATCH_SIZE * sizeof(OFSMEventData) bytes.
+#define OFSM_CONFIG_RUN_TO_COMPLETION_DEPTH 8                   //Default: undefined. When defined, FSM that transitions into a state with zero transition delay gets the timeout event of the new state processed right away,
+                                                                // up to specified number of chained transitions. Otherwise, main loop has to notice expired wakeup time and queue global timeout event.
+                                                                // NOTE: events queued behind the current one are processed after the chain completes, i.e. they never see intermediate zero delay states.
+#define OFSM_CONFIG_COMPACT_TRANSITION_TABLE                    //Default: undefined. When defined, FSM may use compact transition table (2 bytes per cell: handler index and new state) built and validated at compile time.
+                                                                // Include ofsm.table.h after ofsm.decl.h and use OFSM_DECLARE_COMPACT_TRANSITION_TABLE()/OFSM_DECLARE_COMPACT_FSM(), see ofsm.table.h for details. Requires C++11.
+#define OFSM_CONFIG_SPARSE_TRANSITION_TABLE                     //Default: undefined. When defined, FSM declared with OFSM_DECLARE_SPARSE_FSM() uses sparse transition table: per state row of handled events only.
+                                                                // Memory is proportional to number of transitions instead of states x events. See OFSM_DECLARE_SPARSE_FSM in ofsm.decl.h.
+#define OFSM_CONFIG_TRANSITION_TABLE_IN_FLASH                   //Default: undefined. When defined, transition tables are read from program memory (memcpy_P) on AVR, so they don't occupy SRAM.
+                                                                // Every table must be declared 'const' with OFSM_FLASH attribute: dense tables, sparse rows and row arrays, compact handler arrays.
+                                                                // Example: const OFSMTransition transitionTable[][EventCount] OFSM_FLASH = {...};
+                                                                // In simulation OFSM_FLASH is empty and tables are read through the same (memcpy based) path.
+#define OFSM_CONFIG_WIDE_TIME                                   //Default: undefined. When defined, OFSM time is 64 bit (uint64_t): time never wraps, comparisons are plain integer compares and
+                                                                // time overflow flags are never set (overflow bookkeeping is compiled out). Custom heartbeat provider with wrapping 32 bit counter
+                                                                // (e.g. micros()/millis() based) should call ofsm_heartbeat_32(uint32_t currentTicktime) which extends ticks to 64 bit time.
+#define OFSM_CONFIG_FSM_POOL                                    //Default: undefined. When defined, OFSM_DECLARE_FSM_POOL() declares group of identical FSMs that share transition table, initialization handler and private data.
+                                                                // Per instance state, flags, wakeup time and skipped event code are kept in contiguous arrays (structure of arrays), so that group loop
+                                                                // streams through them instead of following pointers to separate OFSM structures. Instance index is fsm_get_fsm_index().
+                                                                // Pool groups are not kept in wakeup index, other groups are (OFSM_CONFIG_WAKEUP_INDEX). ofsm_query_get_fsm() is not available for pool groups.
+#define OFSM_CONFIG_SIMD_TIMEOUT_SWEEP                          //Default: undefined. Requires OFSM_CONFIG_FSM_POOL. Pool group handles timeout event chunk by chunk (64 instances): due bitmap is
+                                                                // computed from wakeup time and flag arrays (AVX2 (-mavx2) or SSE2 when time is 64 bit, scalar otherwise),
+                                                                // timeout is dispatched to due instances only and group wakeup summary is folded from the same arrays.
+#define OFSM_CONFIG_PROFILING                                   //Default: undefined. When defined, every event handler call is timed with OFSM_CONFIG_CUSTOM_PROFILING_CLOCK_FUNC and recorded per (group, fsm, state, event):
+                                                                // invocation and transition counts, max duration and log2 duration histogram. Query: ofsm_query_profile(slotIndex), ofsm_query_profile_find(...),
+                                                                // ofsm_query_profile_dropped_count(); ofsm_profile_reset() clears all. Simulation command: m[etrics] (see PC SIMULATION EVENT GENERATOR).
+#define OFSM_CONFIG_PROFILING_SLOT_COUNT 16                     //Default: 16. Number of (group, fsm, state, event) profiles; handler calls of keys that find no free profile are counted as dropped.
+#define OFSM_CONFIG_PROFILING_BUCKET_COUNT 16                   //Default: 16 (32 in simulation). Number of duration histogram buckets: bucket b counts durations of b significant bits, the last one counts all longer ones.
+#define OFSM_CONFIG_TRACE_BUFFER_SIZE 64                        //Default: undefined. Power of 2. When defined, ofsm records enqueue, overflow drop, dispatch, transition, delay set, sleep enter/exit
+                                                                // and heartbeat that reached wakeup time as 16 bytes binary records (tick time stamp, no formatting) into RAM ring buffer of that many records.
+                                                                // ofsm_trace_dump(writer) writes the buffer through typedef void writer(const uint8_t *data, uint16_t size), e.g. to Serial;
+                                                                // ofsm_trace_reset() clears it. Simulation command: t[race] (see PC SIMULATION EVENT GENERATOR).
+                                                                // Dump is decoded into text or Chrome trace JSON by tools/ofsmTraceDecode.cpp.
+#define OFSM_CONFIG_SNAPSHOT                                    //Default: undefined. When defined, ofsm_snapshot_save(buffer, bufferSize) copies all OFSM runtime state (ofsm flags and times, group queues,
+                                                                // indices and flags, fsm states, flags, wakeup times and skipped event codes) into flat buffer of ofsm_snapshot_size() bytes
+                                                                // and ofsm_snapshot_restore(buffer, size) copies it back (false if the buffer doesn't match current setup).
+                                                                // Must not be called from handlers. Private data of fsms and sketch globals are not included.
+                                                                // Simulation command: c[heckpoint] (see PC SIMULATION EVENT GENERATOR).
 
 //By default OFSM piggybacks Arduino timer0 interrupt and micros()/millis() function to call heartbeat,
 //Custom heartbeat provider is expected to call ofsm_hearbeat(unsigned long currentTicktime);
@@ -168,6 +221,19 @@ OFSM can be "shaped" in many different ways using configuration switches. NOTE:
 #define OFSM_CONFIG_SIMULATION									//Default undefined. Turn SIMULATION mode on. See PC SIMULATION section for additional info
 #define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL 3                    //Default undefined. Enables debug print functionality. Also is used as debug message level filter.
 #define OFSM_CONFIG_SIMULATION_DEBUG_PRINT_ADD_TIMESTAMP        //Default undefined. When defined ofsm_debug_print() it will prefix debug messages with [<current time in ticks>]<debug message>.
+#define OFSM_CONFIG_SIMULATION_TICKLESS                         //Default undefined. When defined (and not in script mode), heartbeat provider thread doesn't tick every OFSM_CONFIG_SIMULATION_TICK_MS:
+                                                                // it sleeps until scheduled wakeup time (or until new wakeup time is published), and OFSM time is computed from elapsed real time (std::chrono::steady_clock).
+#define OFSM_CONFIG_SIMULATION_WORKER_THREADS 3                 //Default undefined. When defined (and not in script mode), groups that need processing are dispatched concurrently to a pool of specified number of worker threads
+                                                                // (ofsm thread takes part as well). Each group is processed by one thread at a time; handlers of different groups run concurrently,
+                                                                // so data shared between groups must be synchronized by the sketch. NOTE: FSM must not be shared between groups when enabled.
+#define OFSM_CONFIG_SIMULATION_WORK_STEALING                    //Default undefined. Requires OFSM_CONFIG_SIMULATION_WORKER_THREADS. Group is scheduled for processing as soon as event is queued (no waiting for the next ofsm round):
+                                                                // every thread owns a deque of ready groups, idle threads steal from others. Group with more queued events stays on the same thread
+                                                                // until its queue is drained, while the rest of the groups are processed by other threads. Suits skewed load (few busy groups, many quiet ones).
+#define OFSM_CONFIG_SIMULATION_VIRTUAL_TIME                     //Default undefined. When defined, script mode (implied) runs discrete event simulation: h[eartbeat],<time> jumps time from one scheduled wakeup time
+                                                                // to the next one (draining all queued events at each of them, regardless of wakeup type) until <time> is reached;
+                                                                // d[elay],<milliseconds> advances time by <milliseconds> / OFSM_CONFIG_SIMULATION_TICK_MS ticks the same way instead of sleeping.
+                                                                // Long simulated periods run without any wall clock sleeping. Consider OFSM_CONFIG_WIDE_TIME for periods longer than 2^32 ticks.
+                                                                // NOTE: existing scripts that step time and wakeups by hand (h, w, d) expect none of the above, don't build them with it (see ofsmVirtualTimeTest.test).
 
 //If OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM is undefined, it get the same value as OFSM_CONFIG_SIMULATION_DEBUG_LEVEL.
 //OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM value determines level of debug/trace output from OFSM. The following are debug output categories levels used by OFSM:
@@ -180,6 +246,16 @@ OFSM can be "shaped" in many different ways using configuration switches. NOTE:
 #define OFSM_CONFIG_SIMULATION_TICK_MS 1000                  //Default 1000 milliseconds in one tick.
 #define OFSM_CONFIG_SIMULATION_SCRIPT_MODE_SLEEP_BETWEEN_EVENTS_MS 0     //Default 0. Sleep period (in milliseconds) before reading new simulation event. May be helpful in batch processing mode.
 #define OFSM_CONFIG_SIMULATION_SCRIPT_MODE					//Default undefined, When defined heartbeat is manually invoked. see PC SIMULATION SCRIPT MODE for details.
+#define OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE                  //Default undefined. When defined, group event queues become bounded multi-producer/single-consumer rings, so that threads queuing events
+                                                                // don't serialize on the simulation mutex. Queuing rules (replace of the last event, buffer overflow) are the same.
+                                                                // ofsm_query_group_flags() doesn't report buffer overflow flag in this mode. Ignored unless OFSM_CONFIG_SIMULATION is defined.
+#define OFSM_CONFIG_MULTI_INSTANCE                              //Default undefined. When defined, runtime state (groups, flags, time, wakeup time, profiles, simulation mutex and sleep condition)
+                                                                // is kept in OFSMContext instead of globals, so that one process hosts many independent orchestras, each on its own thread.
+                                                                // Thread works with context bound by ofsm_context_bind(OFSMContext*) (default context until then): OFSM_SETUP_GROUPS(), OFSM_LOOP(),
+                                                                // queue, heartbeat and query calls; ofsm_context_exit() makes OFSM_LOOP() of bound context return. Producer and heartbeat
+                                                                // threads bind the context of the instance they feed. Trace buffer and simulation event generator stay process wide.
+                                                                // Implies OFSM_CONFIG_SIMULATION_WORKER_THREADS and OFSM_CONFIG_SIMULATION_TICKLESS are undefined. Ignored unless OFSM_CONFIG_SIMULATION is defined.
+                                                                // See bench/ofsmInstanceBench.cpp.
 
 //Default: 0 - (wakeup when queued, including timeout);
 //	Other values:
@@ -199,6 +275,8 @@ CUSTOMIZATION
 #define OFSM_CONFIG_CUSTOM_DEEP_SLEEP_DISABLE_PERIPHERAL_FUNC _ofsm_deep_sleep_disable_peripheral //typedef: void _ofsm_deep_sleep_disable_peripheral()
 #define OFSM_CONFIG_CUSTOM_DEEP_SLEEP_ENABLE_PERIPHERAL_FUNC _ofsm_deep_sleep_enable_peripheral //typedef: void _ofsm_deep_sleep_disable_peripheral()
 #define OFSM_CONFIG_CUSTOM_WATCHDOG_INTERRUPT_HANDLER_FUNC _ofsm_wdt_vector //typedef: void _ofsm_wdt_vector()
+#define OFSM_CONFIG_CUSTOM_PROFILING_CLOCK_FUNC micros       //typedef: uint32_t func(). Handler duration clock of OFSM_CONFIG_PROFILING, e.g. hardware timer/cycle counter read.
+//Default: micros (OFSM_CONFIG_CUSTOM_MICROS_FUNC) on MCU (has to be provided along with OFSM_CONFIG_CUSTOM_HEARTBEAT_PROVIDER); in simulation: rdtsc (cpu cycles) on x86, steady_clock nanoseconds otherwise.
 
 // --------------Simulation Specific Macros -------------------
 #define OFSM_CONFIG_CUSTOM_SIMULATION_CUSTOM_STATUS_REPORT_PRINTER_FUNC _ofsm_simulation_status_report_printer // typedef: void custom_func(OFSMSimulationStatusReport *r)
@@ -249,6 +327,8 @@ Simulation command format: <command>,<parameters>; Value surrounded by '[]' deno
 Any command can optionally be followed by '=' <assert compare string>.
     When specified, event generator will compare <assert compare string> and last output (usually from 'status' or custom command) and issue an assert if there is a mismatch.
 '//' designates comment. Event generator will ignore any text appearing after '//'.
+Up to 16 comma separated tokens per command are parsed, the rest are reported ('ASSERT at line:') and ignored. Parsing doesn't allocate memory (unless command hook is defined).
+Commands and modifiers are case insensitive, spaces around tokens are ignored, empty token is the same as 0 (e.g. q,,1 queues event 0 with data 1).
 The following are commands supported by event generator out of box;
 * e[exit] - exit simulation;
 * d[elay][,<sleep_milliseconds>] - forces event generator to sleep for <sleep_milliseconds> before reading next command; default sleep is 1000 milliseconds.
@@ -271,12 +351,33 @@ The following are commands supported by event generator out of box;
 * p[rint][,<string>]		// prints out <string>
 * w[akup]					// explicitly wakeup OFSM; ignored unless OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE > 0
 * r[eset]					// reset and restart OFSM; mostly used in script mode for creating of test case.
+* m[etrics][,r|<group index>[,<fsm index>]]	// prints handler profiles (requires OFSM_CONFIG_PROFILING) of all groups/fsms or only of specified ones; 'r' resets profiles.
+    -Output: one line per profile: -P-G(<group>)-F(<fsm>)-S(<state>)-E(<event>)-C(<calls>)-T(<transitions>)-MAX(<max duration>)-H(<histogram buckets>),
+        followed by summary line -M-P(<profiles>)-C(<calls>)-T(<transitions>)-D(<dropped calls>), which is used as assert compare string.
+* t[race][,r|-|<file name>]	// dumps binary trace (requires OFSM_CONFIG_TRACE_BUFFER_SIZE) into <file name> (default: ofsm.trace); 'r' clears trace;
+                            // '-' only reports counts, nothing is written (e.g. test scripts).
+    -Output: summary line -T-R(<records in file (in buffer for -)>)-N(<records emitted since reset>), which is used as assert compare string.
+* c[heckpoint][,r]			// saves OFSM state (requires OFSM_CONFIG_SNAPSHOT) as checkpoint; 'r' restores the last saved checkpoint in place: unlike r[eset], threads keep running,
+                            // setup() is not called and there is no waiting, so that test cases may start from warmed up state instead of replaying the preamble.
+                            // Checkpoint is kept across r[eset]. In non script mode command waits until ofsm loop is idle; time goes on from the restored time.
+    -Output: -C-S(<snapshot size>) or -C-R(<snapshot size>), which is used as assert compare string.
 
 You can define OFSM_CONFIG_CUSTOM_SIMULATION_COMMAND_HOOK_FUNC that will be called before command gets processed by the event generator.
 This way you can extend standard set of commands or change their default behavior.
-By returning true, the hook signals event generator that command was processed. Otherwise, event generator will continue processing the command as usual.
+By returning true, the hook signals event generator that command was processed. Otherwise, event generator will continue processing the command as usual
+(with tokens as they were left by the hook). Tokens are copied into the deque for the hook only, so that it costs allocations per command.
 Custom hook may call: ofsm_simulation_set_assert_compare_string(const char* assertCompareString) to allow support for test asserts.
 
+Binary scripts: for high volume replay (e.g. recorded field traces, load tests), text script can be compiled into compact binary operation stream
+by the simulation executable itself: <sketch executable> -c <text script> <binary script>. OFSM is not started while compiling.
+When <binary script> is passed instead of text script, it is memory mapped and executed without any text processing:
+    queue, heartbeat, status etc. call OFSM directly, asserts and line numbers in messages are the same as for the text script.
+    Binary script should be replayed by the executable compiled with the same OFSM_CONFIG_... options.
+    Whole image is validated (header version, operations and operands within file size) before replay starts: truncated or corrupted script
+    is not replayed at all, 'ASSERT at line:' message is printed and executable exits with non zero code.
+    Unrecognized commands and, when OFSM_CONFIG_CUSTOM_SIMULATION_COMMAND_HOOK_FUNC is defined, all commands but print (hook may claim any of them)
+    are kept as text and processed as usual at replay time.
+
 PC SIMULATION SCRIPT MODE
 =========================
 * By default (OFSM_CONFIG_SIMULATION_SCRIPT_MODE is undefined). simulation process runs three threads:
@@ -290,6 +391,9 @@ PC SIMULATION SCRIPT MODE
 *There are couple of ways to supply test data for Script mode:
     1) piping input data into simulated sketch executable (example: mysketch < TestScript.txt)
     2) or by specifying <script file>  on the command line. (example: mysketch TestScript.txt)
+    3) or by tools/ofsmTestRunner.cpp, which splits scripts at reset commands into independent test cases, runs them in parallel
+        by separate sketch processes and reports failed asserts with original line numbers. (example: ofsmTestRunner -j 8 mysketch *.test)
+        With -b every case is also compiled into binary script and replayed; case fails unless replay output is the same as output of text script.
 
 PC SIMULATION REPORT FORMAT
 ===========================
@@ -297,7 +401,10 @@ see implementation of _ofsm_simulation_create_status_report() and _ofsm_simulati
 
 LIMITATIONS
 ============
-* Number of events in single FSM, number of FSMs in single group, number of groups within OFSM must not exceed 255!
+* Number of events in single FSM, number of FSMs in single group, number of groups within OFSM must not exceed the max value of OFSM_CONFIG_INDEX_TYPE (255 with the default uint8_t);
+  the max value itself is reserved as event code (see OFSM_SPARSE_TRANSITION_END and fsm_queue_group_event_exclude_self()).
+* OFSM_DECLARE_... macros declare up to 5 groups of up to 5 FSMs, larger (simulation) setups are built at run time and registered with OFSM_SETUP_GROUPS().
+* When OFSM_CONFIG_WAKEUP_INDEX, OFSM_CONFIG_PENDING_GROUP_BITMAP or OFSM_CONFIG_SIMULATION_WORKER_THREADS is defined, the same FSM instance cannot be shared between different groups.
 
 */
 #ifndef __OFSM_H_
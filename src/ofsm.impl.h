@@ -15,26 +15,909 @@
 Global variables
 -----------------------------------------*/
 
+#ifdef OFSM_CONFIG_MULTI_INSTANCE
+OFSMContext             _ofsmDefaultContext;
+_OFSM_THREAD_LOCAL OFSMContext* _ofsmContext = &_ofsmDefaultContext;
+#else
 OFSMGroup**				_ofsmGroups;
-uint8_t                 _ofsmGroupCount;
-OFSMState*				_ofsmCurrentFsmState;
-volatile uint16_t       _ofsmFlags;
+OFSM_CONFIG_INDEX_TYPE  _ofsmGroupCount;
+volatile _OFSM_FLAGS_DATA_TYPE _ofsmFlags;
 volatile _OFSM_TIME_DATA_TYPE  _ofsmWakeupTime;
 volatile _OFSM_TIME_DATA_TYPE  _ofsmTime;
+#   ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+volatile _OFSM_PENDING_GROUP_DATA_TYPE* _ofsmPendingGroups;
+#       ifdef OFSM_CONFIG_SIMULATION
+volatile _OFSM_PENDING_GROUP_DATA_TYPE* _ofsmSimulationPendingGroups;
+uint32_t                _ofsmSimulationPendingGroupsSize;
+#       endif
+#   endif
+#   ifdef OFSM_CONFIG_PROFILING
+OFSMProfile             _ofsmProfiles[OFSM_CONFIG_PROFILING_SLOT_COUNT];
+uint32_t                _ofsmProfileDroppedCount;
+#   endif
+#endif /*OFSM_CONFIG_MULTI_INSTANCE*/
+_OFSM_THREAD_LOCAL OFSMState* _ofsmCurrentFsmState;
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+OFSMTraceRecord         _ofsmTraceBuffer[OFSM_CONFIG_TRACE_BUFFER_SIZE];
+_OFSM_TRACE_COUNTER_DATA_TYPE _ofsmTraceCount;
+#endif
 
 /*--------------------------------------
 Common (simulation and non-simulation code)
 ----------------------------------------*/
 
-static inline void _ofsm_fsm_process_event(OFSM *fsm, uint8_t groupIndex, uint8_t fsmIndex, OFSMEventData *e)
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+/*------------------------------------------------
+Wakeup index: binary min-heap of group fsms keyed by wakeup time.
+Only fsms that are not in infinite sleep are kept in the heap. Fsm gets re-keyed when its wakeup time or flags are changed by _ofsm_fsm_process_event().
+-------------------------------------------------*/
+static void _ofsm_wakeup_index_sift(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE heapPosition)
+{
+    OFSM_CONFIG_INDEX_TYPE *heap = group->wakeupIndexHeap;
+    OFSM_CONFIG_INDEX_TYPE fsmIndex = heap[heapPosition];
+    OFSM *fsm = (group->fsms)[fsmIndex];
+    OFSM *other;
+    unsigned long pos = heapPosition;
+    unsigned long next;
+
+    /*sift up*/
+    while (pos > 0) {
+        next = (pos - 1) >> 1;
+        other = (group->fsms)[heap[next]];
+        if (!_OFSM_TIME_KEY_A_LT_B(fsm->wakeupTime, (fsm->flags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW), other->wakeupTime, (other->flags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW))) {
+            break;
+        }
+        heap[pos] = heap[next];
+        (group->wakeupIndexPosition)[heap[pos]] = (OFSM_CONFIG_INDEX_TYPE)(pos + 1);
+        pos = next;
+    }
+
+    /*sift down*/
+    while ((next = (pos << 1) + 1) < group->wakeupIndexSize) {
+        other = (group->fsms)[heap[next]];
+        if (next + 1 < group->wakeupIndexSize) {
+            OFSM *right = (group->fsms)[heap[next + 1]];
+            if (_OFSM_TIME_KEY_A_LT_B(right->wakeupTime, (right->flags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW), other->wakeupTime, (other->flags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW))) {
+                next++;
+                other = right;
+            }
+        }
+        if (!_OFSM_TIME_KEY_A_LT_B(other->wakeupTime, (other->flags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW), fsm->wakeupTime, (fsm->flags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW))) {
+            break;
+        }
+        heap[pos] = heap[next];
+        (group->wakeupIndexPosition)[heap[pos]] = (OFSM_CONFIG_INDEX_TYPE)(pos + 1);
+        pos = next;
+    }
+
+    heap[pos] = fsmIndex;
+    (group->wakeupIndexPosition)[fsmIndex] = (OFSM_CONFIG_INDEX_TYPE)(pos + 1);
+}/*_ofsm_wakeup_index_sift*/
+
+static void _ofsm_wakeup_index_update(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE fsmIndex)
+{
+    OFSM *fsm = (group->fsms)[fsmIndex];
+    OFSM_CONFIG_INDEX_TYPE pos = (group->wakeupIndexPosition)[fsmIndex];
+
+    /*keep track of fsms that prevent deep sleep*/
+    if (((group->wakeupIndexFsmFlags)[fsmIndex] ^ fsm->flags) & _OFSM_FLAG_ALLOW_DEEP_SLEEP) {
+        if (fsm->flags & _OFSM_FLAG_ALLOW_DEEP_SLEEP) {
+            group->wakeupIndexNoDeepSleepCount--;
+        }
+        else {
+            group->wakeupIndexNoDeepSleepCount++;
+        }
+    }
+    (group->wakeupIndexFsmFlags)[fsmIndex] = fsm->flags;
+
+    /*fsm in infinite sleep never wakes up by timeout, remove it from the heap*/
+    if (fsm->flags & _OFSM_FLAG_INFINITE_SLEEP) {
+        if (pos) {
+            (group->wakeupIndexPosition)[fsmIndex] = 0;
+            group->wakeupIndexSize--;
+            if (pos - 1 < group->wakeupIndexSize) {
+                (group->wakeupIndexHeap)[pos - 1] = (group->wakeupIndexHeap)[group->wakeupIndexSize];
+                _ofsm_wakeup_index_sift(group, pos - 1);
+            }
+        }
+        return;
+    }
+
+    if (!pos) {
+        pos = ++group->wakeupIndexSize;
+        (group->wakeupIndexHeap)[pos - 1] = fsmIndex;
+    }
+    _ofsm_wakeup_index_sift(group, pos - 1);
+}/*_ofsm_wakeup_index_update*/
+
+static void _ofsm_wakeup_index_rebuild(OFSMGroup *group)
+{
+    OFSM_CONFIG_INDEX_TYPE i;
+    group->wakeupIndexSize = 0;
+    group->wakeupIndexNoDeepSleepCount = group->groupSize;
+    for (i = 0; i < group->groupSize; i++) {
+        (group->wakeupIndexPosition)[i] = 0;
+        (group->wakeupIndexFsmFlags)[i] = 0;
+    }
+    for (i = 0; i < group->groupSize; i++) {
+        _ofsm_wakeup_index_update(group, i);
+    }
+}/*_ofsm_wakeup_index_rebuild*/
+#endif /*OFSM_CONFIG_WAKEUP_INDEX*/
+
+/*copy transition of given state and event out of fsm transition table*/
+static inline void _ofsm_fsm_get_transition(OFSM *fsm, OFSM_CONFIG_INDEX_TYPE state, OFSM_CONFIG_INDEX_TYPE eventCode, OFSMTransition *t)
+{
+#ifdef OFSM_CONFIG_SPARSE_TRANSITION_TABLE
+    OFSMSparseTransition *row;
+    OFSMSparseTransition entry;
+    if (fsm->transitionTableType == _OFSM_TRANSITION_TABLE_TYPE_SPARSE) {
+        _OFSM_TABLE_READ(&row, ((OFSMSparseTransition**)fsm->transitionTable) + state);
+        _OFSM_TABLE_READ(&entry, row);
+        /*row is sorted by event code and terminated by 0xFF: timeout (event 0) is either the very first entry or not handled*/
+        while (entry.eventCode < eventCode) {
+            row++;
+            _OFSM_TABLE_READ(&entry, row);
+        }
+        if (entry.eventCode == eventCode) {
+            t->eventHandler = entry.eventHandler;
+            t->newState = entry.newState;
+        }
+        else {
+            t->eventHandler = 0;
+            t->newState = 0;
+        }
+        return;
+    }
+#endif
+#ifdef OFSM_CONFIG_COMPACT_TRANSITION_TABLE
+    OFSMCompactTransition c;
+    if (fsm->transitionTableType == _OFSM_TRANSITION_TABLE_TYPE_COMPACT) {
+        _OFSM_TABLE_READ(&c, ((OFSMCompactTransition*)fsm->transitionTable) + fsm->transitionTableEventCount * state + eventCode);
+        if (0 == c.handlerIndex) {
+            t->eventHandler = 0;
+        }
+        else if (OFSM_COMPACT_NOP_HANDLER_INDEX == c.handlerIndex) {
+            t->eventHandler = OFSM_NOP_HANDLER;
+        }
+        else {
+            _OFSM_TABLE_READ(&t->eventHandler, fsm->transitionHandlers + c.handlerIndex - 1);
+        }
+        t->newState = c.newState;
+        return;
+    }
+#endif
+    _OFSM_TABLE_READ(t, _OFSM_GET_STATE_TRANSTION(fsm, state, eventCode));
+}/*_ofsm_fsm_get_transition*/
+
+#ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+/*build per state bitmask of events that have handler (including OFSM_NOP_HANDLER)*/
+static void _ofsm_fsm_build_event_interest_mask(OFSM *fsm)
+{
+    OFSM_CONFIG_INDEX_TYPE state, eventCode;
+    uint8_t *mask = fsm->eventInterestMask;
+    OFSMTransition t;
+    for (state = 0; state < fsm->transitionTableStateCount; state++) {
+        for (eventCode = 0; eventCode < fsm->transitionTableEventCount; eventCode++) {
+            if (!(eventCode & 7)) {
+                mask[eventCode >> 3] = 0;
+            }
+            _ofsm_fsm_get_transition(fsm, state, eventCode, &t);
+            if (t.eventHandler) {
+                mask[eventCode >> 3] |= (1 << (eventCode & 7));
+            }
+        }
+        mask += _OFSM_EVENT_INTEREST_MASK_STRIDE(fsm);
+    }
+}/*_ofsm_fsm_build_event_interest_mask*/
+#endif /*OFSM_CONFIG_EVENT_INTEREST_MASK*/
+
+#ifdef OFSM_CONFIG_FSM_POOL
+/*------------------------------------------------
+FSM pool: per instance fields live in contiguous arrays of the pool.
+Instance is processed by shared fsm of the pool: fields are loaded into it before processing and stored back after,
+so that transition table, handlers and fsm_... API work the same way for pooled and regular fsms.
+Group is processed by single thread at a time, so shared fsm of the group is never used concurrently.
+-------------------------------------------------*/
+static inline OFSM *_ofsm_group_fsm_load(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE fsmIndex)
+{
+    OFSMPool *pool = group->pool;
+    if (!pool) {
+        return (group->fsms)[fsmIndex];
+    }
+    pool->fsm->currentState = (pool->currentState)[fsmIndex];
+    pool->fsm->flags = (pool->flags)[fsmIndex];
+    pool->fsm->wakeupTime = (pool->wakeupTime)[fsmIndex];
+    pool->fsm->skipNextEventCode = (pool->skipNextEventCode)[fsmIndex];
+    return pool->fsm;
+}
+
+static inline void _ofsm_group_fsm_store(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE fsmIndex)
+{
+    OFSMPool *pool = group->pool;
+    if (!pool) {
+        return;
+    }
+    (pool->currentState)[fsmIndex] = pool->fsm->currentState;
+    (pool->flags)[fsmIndex] = pool->fsm->flags;
+    (pool->wakeupTime)[fsmIndex] = pool->fsm->wakeupTime;
+    (pool->skipNextEventCode)[fsmIndex] = pool->fsm->skipNextEventCode;
+}
+
+/*put all instances of pool group into initial state*/
+static void _ofsm_pool_reset(OFSMGroup *group)
+{
+    OFSMPool *pool = group->pool;
+    OFSM_CONFIG_INDEX_TYPE i;
+    for (i = 0; i < group->groupSize; i++) {
+        (pool->currentState)[i] = pool->initialState;
+        (pool->flags)[i] = _OFSM_FLAG_INFINITE_SLEEP;
+        (pool->wakeupTime)[i] = 0;
+        (pool->skipNextEventCode)[i] = (OFSM_CONFIG_INDEX_TYPE)-1;
+    }
+}/*_ofsm_pool_reset*/
+
+#ifdef OFSM_CONFIG_SIMD_TIMEOUT_SWEEP
+/*------------------------------------------------
+Timeout sweep: pool group handles timeout event chunk by chunk (up to 64 instances).
+Due bitmap of the chunk is produced in one pass over wakeup time and flag arrays, timeout event is dispatched only to set bits,
+then wakeup summary of the chunk is folded from the same (cache hot) arrays.
+Lanes are 64 bit wakeup times: AVX2 - 4 lanes, SSE2 - 2 lanes; lanes of instances with scheduled time overflow are folded one by one,
+so that the summary is exactly the one of the group loop.
+-------------------------------------------------*/
+#   define _OFSM_TIMEOUT_SWEEP_CHUNK 64
+
+#   if defined(_OFSM_TIMEOUT_SWEEP_AVX2)
+#       define _OFSM_SWEEP_LANES 4
+#       define _OFSM_SWEEP_BIAS 0x8000000000000000ULL /*unsigned to signed 64 bit compare*/
+typedef __m256i _OFSMSweepVector;
+#       define _ofsm_sweep_set1(v) _mm256_set1_epi64x((long long)(v))
+#       define _ofsm_sweep_and(a, b) _mm256_and_si256(a, b)
+#       define _ofsm_sweep_or(a, b) _mm256_or_si256(a, b)
+#       define _ofsm_sweep_andnot(a, b) _mm256_andnot_si256(a, b) /*~a & b*/
+#       define _ofsm_sweep_xor(a, b) _mm256_xor_si256(a, b)
+#       define _ofsm_sweep_select(mask, a, b) _mm256_blendv_epi8(a, b, mask) /*mask ? b : a*/
+#       define _ofsm_sweep_movemask(v) ((uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(v)))
+#       define _ofsm_sweep_store(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+static inline _OFSMSweepVector _ofsm_sweep_load_time(const _OFSM_TIME_DATA_TYPE *p) {
+    return _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)p), _ofsm_sweep_set1(_OFSM_SWEEP_BIAS));
+}
+static inline _OFSMSweepVector _ofsm_sweep_load_flags(const uint8_t *p) {
+    int32_t flags;
+    memcpy(&flags, p, sizeof(flags));
+    return _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(flags));
+}
+static inline _OFSMSweepVector _ofsm_sweep_gt(_OFSMSweepVector a, _OFSMSweepVector b) {
+    return _mm256_cmpgt_epi64(a, b);
+}
+/*lanes where none of the flags is set*/
+static inline _OFSMSweepVector _ofsm_sweep_flags_clear(_OFSMSweepVector f, _OFSMSweepVector flags) {
+    return _mm256_cmpeq_epi64(_mm256_and_si256(f, flags), _mm256_setzero_si256());
+}
+#   elif defined(_OFSM_TIMEOUT_SWEEP_SSE2)
+#       define _OFSM_SWEEP_LANES 2
+#       define _OFSM_SWEEP_BIAS 0x8000000080000000ULL /*unsigned to signed compare of each 32 bit half*/
+typedef __m128i _OFSMSweepVector;
+#       define _ofsm_sweep_set1(v) _mm_set1_epi64x((long long)(v))
+#       define _ofsm_sweep_and(a, b) _mm_and_si128(a, b)
+#       define _ofsm_sweep_or(a, b) _mm_or_si128(a, b)
+#       define _ofsm_sweep_andnot(a, b) _mm_andnot_si128(a, b) /*~a & b*/
+#       define _ofsm_sweep_xor(a, b) _mm_xor_si128(a, b)
+#       define _ofsm_sweep_select(mask, a, b) _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a)) /*mask ? b : a*/
+#       define _ofsm_sweep_movemask(v) ((uint64_t)_mm_movemask_pd(_mm_castsi128_pd(v)))
+#       define _ofsm_sweep_store(p, v) _mm_storeu_si128((__m128i*)(p), v)
+static inline _OFSMSweepVector _ofsm_sweep_load_time(const _OFSM_TIME_DATA_TYPE *p) {
+    return _mm_xor_si128(_mm_loadu_si128((const __m128i*)p), _ofsm_sweep_set1(_OFSM_SWEEP_BIAS));
+}
+static inline _OFSMSweepVector _ofsm_sweep_load_flags(const uint8_t *p) {
+    return _mm_set_epi64x(p[1], p[0]);
+}
+/*SSE2 has no 64 bit compare: high halves decide unless they are equal*/
+static inline _OFSMSweepVector _ofsm_sweep_gt(_OFSMSweepVector a, _OFSMSweepVector b) {
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    __m128i eq = _mm_cmpeq_epi32(a, b);
+    return _mm_or_si128(_mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1)),
+        _mm_and_si128(_mm_shuffle_epi32(eq, _MM_SHUFFLE(3, 3, 1, 1)), _mm_shuffle_epi32(gt, _MM_SHUFFLE(2, 2, 0, 0))));
+}
+/*lanes where none of the flags is set (flags live in low half)*/
+static inline _OFSMSweepVector _ofsm_sweep_flags_clear(_OFSMSweepVector f, _OFSMSweepVector flags) {
+    return _mm_shuffle_epi32(_mm_cmpeq_epi32(_mm_and_si128(f, flags), _mm_setzero_si128()), _MM_SHUFFLE(2, 2, 0, 0));
+}
+#   endif
+
+/*bit per instance of [first, first + count) that has to get timeout event:
+wakeup time is reached and instance is not blocked by blockingFlags (infinite sleep), or timeout is set to be skipped (skip has to be reset)*/
+static inline uint64_t _ofsm_pool_timeout_sweep_due(OFSMPool *pool, unsigned long first, uint8_t count, _OFSM_TIME_DATA_TYPE currentTime, uint8_t timeFlags, uint8_t blockingFlags)
+{
+    uint64_t due = 0;
+    uint8_t i = 0;
+    uint8_t fsmFlags;
+#   ifdef _OFSM_SWEEP_LANES
+    const _OFSMSweepVector nowV = _ofsm_sweep_xor(_ofsm_sweep_set1(currentTime), _ofsm_sweep_set1(_OFSM_SWEEP_BIAS));
+    const _OFSMSweepVector blockingV = _ofsm_sweep_set1(blockingFlags);
+#       ifndef OFSM_CONFIG_WIDE_TIME
+    const _OFSMSweepVector overflowV = _ofsm_sweep_set1(_OFSM_FLAG_SCHEDULED_TIME_OVERFLOW);
+    _OFSMSweepVector overflowClear;
+    uint64_t mask;
+#       endif
+    _OFSMSweepVector f, w, later;
+    for (; i + _OFSM_SWEEP_LANES <= count; i += _OFSM_SWEEP_LANES) {
+        f = _ofsm_sweep_load_flags(pool->flags + first + i);
+        w = _ofsm_sweep_load_time(pool->wakeupTime + first + i);
+        later = _ofsm_sweep_gt(w, nowV);
+#       ifndef OFSM_CONFIG_WIDE_TIME
+        /*wakeup time of the other epoch than current time is later when it is smaller (see _OFSM_TIME_A_GT_B)*/
+        overflowClear = _ofsm_sweep_flags_clear(f, overflowV);
+        mask = _ofsm_sweep_movemask(overflowClear);
+        if (timeFlags & _OFSM_FLAG_OFSM_TIMER_OVERFLOW) {
+            if (mask) {
+                later = _ofsm_sweep_select(overflowClear, later, _ofsm_sweep_gt(nowV, w));
+            }
+        }
+        else if (mask != ((1 << _OFSM_SWEEP_LANES) - 1)) {
+            later = _ofsm_sweep_select(overflowClear, _ofsm_sweep_gt(nowV, w), later);
+        }
+#       endif
+        due |= _ofsm_sweep_movemask(_ofsm_sweep_andnot(later, _ofsm_sweep_flags_clear(f, blockingV))) << i;
+    }
+#   endif
+    for (; i < count; i++) {
+        fsmFlags = (pool->flags)[first + i];
+        if (!(fsmFlags & blockingFlags)
+            && !_OFSM_TIME_A_GT_B((pool->wakeupTime)[first + i], (fsmFlags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW), currentTime, (timeFlags & _OFSM_FLAG_OFSM_TIMER_OVERFLOW))) {
+            due |= ((uint64_t)1 << i);
+        }
+    }
+    for (i = 0; i < count; i++) {
+        if (!(pool->skipNextEventCode)[first + i]) {
+            due |= ((uint64_t)1 << i);
+        }
+    }
+    return due;
+}
+
+/*fold wakeup summary of instances [first, first + count) into earliestWakeupTime/andedFsmFlags the same way group loop does it one fsm at a time.
+Lanes of the same epoch (scheduled time overflow flag) take plain minimum, so that lanes of each epoch are folded together;
+lanes of mixed epochs are folded one by one*/
+static inline void _ofsm_pool_timeout_sweep_summary(OFSMPool *pool, unsigned long first, uint8_t count, _OFSM_TIME_DATA_TYPE *earliestWakeupTime, uint8_t *andedFsmFlags)
+{
+    uint8_t i = 0;
+    uint8_t fsmFlags;
+    _OFSM_TIME_DATA_TYPE earliestWakeupTimeLocal = *earliestWakeupTime;
+    uint8_t andedFsmFlagsLocal = *andedFsmFlags;
+#   ifdef _OFSM_SWEEP_LANES
+    const _OFSMSweepVector infiniteSleepV = _ofsm_sweep_set1(_OFSM_FLAG_INFINITE_SLEEP);
+#       ifdef OFSM_CONFIG_WIDE_TIME
+    const _OFSMSweepVector overflowV = _ofsm_sweep_set1(0); /*overflow is ignored, all lanes are folded together*/
+#       else
+    const _OFSMSweepVector overflowV = _ofsm_sweep_set1(_OFSM_FLAG_SCHEDULED_TIME_OVERFLOW);
+#       endif
+    const _OFSMSweepVector maxV = _ofsm_sweep_set1((uint64_t)-1 ^ _OFSM_SWEEP_BIAS);
+    _OFSMSweepVector minV[2] = { maxV, maxV };                                          /*per epoch parity*/
+    _OFSMSweepVector awakeV[2] = { _ofsm_sweep_set1(0), _ofsm_sweep_set1(0) };          /*lanes that hold wakeup time of fsm which is not in infinite sleep*/
+    _OFSMSweepVector f, w, awake;
+    uint64_t lanesFlags = (uint64_t)-1;   /*flags of same epoch lanes, byte per lane; anded into summary once minimums are folded, so that infinite sleep flag still tells that summary has no wakeup time yet*/
+    uint64_t chunkFlags = 0;
+    uint64_t lanes[_OFSM_SWEEP_LANES];
+    uint64_t mask;
+    uint8_t parity;
+    uint8_t k;
+    for (; i + _OFSM_SWEEP_LANES <= count; i += _OFSM_SWEEP_LANES) {
+        f = _ofsm_sweep_load_flags(pool->flags + first + i);
+        mask = _ofsm_sweep_movemask(_ofsm_sweep_flags_clear(f, overflowV));
+        if (mask == ((1 << _OFSM_SWEEP_LANES) - 1) || !mask) {
+            /*infinite sleep lanes take max, so that they never win*/
+            awake = _ofsm_sweep_flags_clear(f, infiniteSleepV);
+            w = _ofsm_sweep_select(awake, maxV, _ofsm_sweep_load_time(pool->wakeupTime + first + i));
+            if (mask) {
+                minV[0] = _ofsm_sweep_select(_ofsm_sweep_gt(minV[0], w), minV[0], w);
+                awakeV[0] = _ofsm_sweep_or(awakeV[0], awake);
+            }
+            else {
+                minV[1] = _ofsm_sweep_select(_ofsm_sweep_gt(minV[1], w), minV[1], w);
+                awakeV[1] = _ofsm_sweep_or(awakeV[1], awake);
+            }
+            memcpy(&chunkFlags, pool->flags + first + i, _OFSM_SWEEP_LANES);
+            lanesFlags &= chunkFlags;
+            continue;
+        }
+        for (k = 0; k < _OFSM_SWEEP_LANES; k++) {
+            fsmFlags = (pool->flags)[first + i + k];
+            _OFSM_WAKEUP_FOLD(earliestWakeupTimeLocal, andedFsmFlagsLocal, (pool->wakeupTime)[first + i + k], fsmFlags);
+        }
+    }
+    for (parity = 0; parity < 2; parity++) {
+        mask = _ofsm_sweep_movemask(awakeV[parity]);
+        if (!mask) {
+            continue;
+        }
+        _ofsm_sweep_store(lanes, minV[parity]);
+        for (k = 0; k < _OFSM_SWEEP_LANES; k++) {
+            if (mask & ((uint64_t)1 << k)) {
+                fsmFlags = (uint8_t)(~(_OFSM_FLAG_INFINITE_SLEEP | _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW) | (parity ? _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW : 0));
+                _OFSM_WAKEUP_FOLD(earliestWakeupTimeLocal, andedFsmFlagsLocal, (_OFSM_TIME_DATA_TYPE)(lanes[k] ^ _OFSM_SWEEP_BIAS), fsmFlags);
+            }
+        }
+    }
+    for (k = 0; k < _OFSM_SWEEP_LANES; k++) {
+        andedFsmFlagsLocal &= (uint8_t)((lanesFlags >> (8 * k)) | _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW);
+    }
+#   endif
+    for (; i < count; i++) {
+        fsmFlags = (pool->flags)[first + i];
+        _OFSM_WAKEUP_FOLD(earliestWakeupTimeLocal, andedFsmFlagsLocal, (pool->wakeupTime)[first + i], fsmFlags);
+    }
+    *earliestWakeupTime = earliestWakeupTimeLocal;
+    *andedFsmFlags = andedFsmFlagsLocal;
+}
+
+/*timeout event (e) or wakeup summary only (e is NULL) of pool group*/
+static void _ofsm_pool_timeout_sweep(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE groupIndex, OFSMEventData *e, _OFSM_TIME_DATA_TYPE *earliestWakeupTime, uint8_t *andedFsmFlags)
+{
+    OFSMPool *pool = group->pool;
+    OFSM *fsm;
+    unsigned long first;
+    uint8_t count;
+    uint64_t due;
+    OFSM_CONFIG_INDEX_TYPE fsmIndex;
+    _OFSM_TIME_DATA_TYPE currentTime = 0;
+    uint8_t timeFlags = 0;
+    /*during first iteration timeout is delivered to fsms in infinite sleep as well*/
+    uint8_t blockingFlags = ((_ofsmFlags & _OFSM_FLAG_OFSM_FIRST_ITERATION) ? 0 : _OFSM_FLAG_INFINITE_SLEEP);
+
+    if (e) {
+        ofsm_get_time(currentTime, timeFlags);
+    }
+    for (first = 0; first < group->groupSize; first += _OFSM_TIMEOUT_SWEEP_CHUNK) {
+        count = (uint8_t)(group->groupSize - first < _OFSM_TIMEOUT_SWEEP_CHUNK ? group->groupSize - first : _OFSM_TIMEOUT_SWEEP_CHUNK);
+        if (e) {
+            due = _ofsm_pool_timeout_sweep_due(pool, first, count, currentTime, timeFlags, blockingFlags);
+            while (due) {
+                fsmIndex = (OFSM_CONFIG_INDEX_TYPE)(first + __builtin_ctzll(due));
+                due &= (due - 1);
+                fsm = _ofsm_group_fsm_load(group, fsmIndex);
+                if (_OFSM_FSM_ACCEPTS_EVENT(fsm, e->eventCode)) {
+                    _OFSM_FSM_PROCESS_EVENT(fsm, groupIndex, fsmIndex, e);
+                    _ofsm_group_fsm_store(group, fsmIndex);
+                }
+            }
+        }
+        _ofsm_pool_timeout_sweep_summary(pool, first, count, earliestWakeupTime, andedFsmFlags);
+    }
+}/*_ofsm_pool_timeout_sweep*/
+#endif /*OFSM_CONFIG_SIMD_TIMEOUT_SWEEP*/
+#endif /*OFSM_CONFIG_FSM_POOL*/
+
+#ifdef OFSM_CONFIG_PROFILING
+/*------------------------------------------------
+Handler profiling: open addressing table of (group, fsm, state, event) slots.
+Slot is claimed by the first handler invocation of its key; once all slots are claimed, invocations of new keys are only counted as dropped.
+-------------------------------------------------*/
+static OFSMProfile* _ofsm_profile_lookup(OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSM_CONFIG_INDEX_TYPE state, OFSM_CONFIG_INDEX_TYPE eventCode, bool claim)
+{
+    unsigned long start = ((((unsigned long)groupIndex * 31 + fsmIndex) * 31 + state) * 31 + eventCode) % OFSM_CONFIG_PROFILING_SLOT_COUNT;
+    unsigned long i;
+    OFSMProfile *p;
+
+    for (i = 0; i < OFSM_CONFIG_PROFILING_SLOT_COUNT; i++) {
+        p = &(_ofsmProfiles[(start + i) % OFSM_CONFIG_PROFILING_SLOT_COUNT]);
+        if (!p->count) {
+            if (!claim) {
+                return NULL; /*slots are never released one by one, so the key would have been found before the first free slot*/
+            }
+            p->groupIndex = groupIndex;
+            p->fsmIndex = fsmIndex;
+            p->state = state;
+            p->eventCode = eventCode;
+            return p;
+        }
+        if (p->groupIndex == groupIndex && p->fsmIndex == fsmIndex && p->state == state && p->eventCode == eventCode) {
+            return p;
+        }
+    }
+    return NULL;
+}/*_ofsm_profile_lookup*/
+
+static inline void _ofsm_profile_record(OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSM_CONFIG_INDEX_TYPE state, OFSM_CONFIG_INDEX_TYPE eventCode, uint32_t duration, uint8_t transitioned)
+{
+    OFSMProfile *p;
+    uint8_t bucket;
+
+    /*bucket: number of significant bits of duration*/
+    for (bucket = 0; duration >> bucket && bucket < OFSM_CONFIG_PROFILING_BUCKET_COUNT - 1; bucket++);
+
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        p = _ofsm_profile_lookup(groupIndex, fsmIndex, state, eventCode, true);
+        if (!p) {
+            _ofsmProfileDroppedCount++;
+        }
+        else {
+            p->count++;
+            p->transitionCount += transitioned;
+            if (duration > p->maxDuration) {
+                p->maxDuration = duration;
+            }
+            (p->histogram)[bucket]++;
+        }
+    }
+}/*_ofsm_profile_record*/
+
+OFSMProfile* ofsm_query_profile_find(OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSM_CONFIG_INDEX_TYPE state, OFSM_CONFIG_INDEX_TYPE eventCode)
+{
+    OFSMProfile *p = NULL;
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        p = _ofsm_profile_lookup(groupIndex, fsmIndex, state, eventCode, false);
+    }
+    return p;
+}/*ofsm_query_profile_find*/
+
+void ofsm_profile_reset()
+{
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        memset(_ofsmProfiles, 0, sizeof(_ofsmProfiles));
+        _ofsmProfileDroppedCount = 0;
+    }
+}/*ofsm_profile_reset*/
+#endif /*OFSM_CONFIG_PROFILING*/
+
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+/*------------------------------------------------
+Binary trace: ring buffer of fixed size records, the oldest records get overwritten.
+Record is claimed by incrementing counter; there is no formatting, decoding is done off-line (tools/ofsmTraceDecode.cpp).
+-------------------------------------------------*/
+static inline void _ofsm_trace(uint8_t type, OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSM_CONFIG_INDEX_TYPE code, uint8_t flags, uint32_t value)
+{
+    OFSMTraceRecord *r;
+#ifdef OFSM_CONFIG_SIMULATION
+    {
+        /*producers may not hold simulation mutex (lock-free queue, workers)*/
+        r = &(_ofsmTraceBuffer[_ofsmTraceCount.fetch_add(1, std::memory_order_relaxed) & (OFSM_CONFIG_TRACE_BUFFER_SIZE - 1)]);
+#else
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        r = &(_ofsmTraceBuffer[_ofsmTraceCount++ & (OFSM_CONFIG_TRACE_BUFFER_SIZE - 1)]);
+#endif
+        r->time = (uint32_t)_ofsmTime;
+        r->value = value;
+        r->groupIndex = (uint16_t)groupIndex;
+        r->fsmIndex = (uint16_t)fsmIndex;
+        r->code = (uint16_t)code;
+        r->type = type;
+        r->flags = flags;
+    }
+}/*_ofsm_trace*/
+
+/*writes 16 bytes header ("OFTR", uint16 version 1, uint16 record size, uint32 number of records in dump, uint32 number of records
+emitted since reset) followed by records from the oldest to the newest. Header is little-endian, records are in MCU byte order.
+Records are copied one by one with interrupts disabled, writer is called with interrupts enabled (it may be Serial.write()).
+Records emitted after dump started are not included*/
+void ofsm_trace_dump(OFSMTraceWriter writer)
+{
+    uint8_t header[16] = { 'O', 'F', 'T', 'R', 1, 0, sizeof(OFSMTraceRecord), 0 };
+    OFSMTraceRecord r;
+    uint32_t total, count, i;
+
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        total = _ofsmTraceCount;
+    }
+    count = (total < OFSM_CONFIG_TRACE_BUFFER_SIZE ? total : OFSM_CONFIG_TRACE_BUFFER_SIZE);
+    for (i = 0; i < 4; i++) {
+        header[8 + i] = (uint8_t)(count >> (8 * i));
+        header[12 + i] = (uint8_t)(total >> (8 * i));
+    }
+    writer(header, sizeof(header));
+    for (i = total - count; i != total; i++) {
+        OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+            r = _ofsmTraceBuffer[i & (OFSM_CONFIG_TRACE_BUFFER_SIZE - 1)];
+        }
+        writer((const uint8_t*)&r, sizeof(r));
+    }
+}/*ofsm_trace_dump*/
+
+void ofsm_trace_reset()
+{
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        _ofsmTraceCount = 0;
+    }
+}/*ofsm_trace_reset*/
+#endif /*OFSM_CONFIG_TRACE_BUFFER_SIZE*/
+
+#ifdef OFSM_CONFIG_SNAPSHOT
+/*------------------------------------------------
+Snapshot: flat copy of all runtime state (ofsm flags and times, group queues, indices, flags and caches, fsm state, flags, wakeup time
+and skipped event code). Layout block (group count, group and queue sizes) comes first, so that restore rejects snapshot of different setup
+before anything is modified. Buffer is in MCU byte order, it is meant to be restored by the same executable.
+Transition tables, private data and handler side effects are not part of the snapshot.
+-------------------------------------------------*/
+#define _OFSM_SNAPSHOT_SIZE     0
+#define _OFSM_SNAPSHOT_SAVE     1
+#define _OFSM_SNAPSHOT_RESTORE  2
+#define _OFSM_SNAPSHOT_MAGIC    0x5353464FUL /*"OFSS"*/
+
+/*copy value between state and buffer by value, so that volatile and atomic fields go through their regular load/store*/
+#define _OFSM_SNAPSHOT_FIELD(type, lvalue) { \
+        type _ofsm_snapshot_value; \
+        if (mode == _OFSM_SNAPSHOT_SAVE) { \
+            _ofsm_snapshot_value = (type)(lvalue); \
+            memcpy(buffer + pos, &_ofsm_snapshot_value, sizeof(type)); \
+        } \
+        else if (mode == _OFSM_SNAPSHOT_RESTORE) { \
+            memcpy(&_ofsm_snapshot_value, buffer + pos, sizeof(type)); \
+            lvalue = _ofsm_snapshot_value; \
+        } \
+        pos += sizeof(type); \
+    }
+#define _OFSM_SNAPSHOT_ARRAY(ptr, byteCount) { \
+        if (mode == _OFSM_SNAPSHOT_SAVE) { \
+            memcpy(buffer + pos, (const void*)(ptr), (byteCount)); \
+        } \
+        else if (mode == _OFSM_SNAPSHOT_RESTORE) { \
+            memcpy((void*)(ptr), buffer + pos, (byteCount)); \
+        } \
+        pos += (byteCount); \
+    }
+#define _OFSM_SNAPSHOT_LAYOUT(value) { \
+        uint32_t _ofsm_snapshot_value = (uint32_t)(value); \
+        if (mode == _OFSM_SNAPSHOT_SAVE) { \
+            memcpy(buffer + pos, &_ofsm_snapshot_value, sizeof(uint32_t)); \
+        } \
+        else if (mode == _OFSM_SNAPSHOT_RESTORE && memcmp(buffer + pos, &_ofsm_snapshot_value, sizeof(uint32_t))) { \
+            layoutMismatch = true; \
+        } \
+        pos += sizeof(uint32_t); \
+    }
+
+/*walks the state in fixed order, must be called from within atomic block.
+Returns: snapshot size; 0 - restore of snapshot with different layout (nothing is restored)*/
+static uint32_t _ofsm_snapshot_walk(uint8_t *buffer, uint8_t mode)
+{
+    uint32_t pos = 0;
+    bool layoutMismatch = false;
+    OFSM_CONFIG_INDEX_TYPE i, k;
+    OFSMGroup *group;
+    OFSM *fsm;
+
+    _OFSM_SNAPSHOT_LAYOUT(_OFSM_SNAPSHOT_MAGIC);
+    _OFSM_SNAPSHOT_LAYOUT(_ofsmGroupCount);
+    for (i = 0; i < _ofsmGroupCount; i++) {
+        group = (_ofsmGroups)[i];
+        _OFSM_SNAPSHOT_LAYOUT(group->groupSize);
+        _OFSM_SNAPSHOT_LAYOUT(group->eventQueueSize);
+    }
+    if (layoutMismatch) {
+        return 0;
+    }
+
+    _OFSM_SNAPSHOT_FIELD(uint16_t, _ofsmFlags);
+    _OFSM_SNAPSHOT_FIELD(_OFSM_TIME_DATA_TYPE, _ofsmTime);
+    _OFSM_SNAPSHOT_FIELD(_OFSM_TIME_DATA_TYPE, _ofsmWakeupTime);
+#ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+    for (i = 0; i < ((_ofsmGroupCount + 7) >> 3); i++) {
+        _OFSM_SNAPSHOT_FIELD(uint8_t, _ofsmPendingGroups[i]);
+    }
+#endif
+
+    for (i = 0; i < _ofsmGroupCount; i++) {
+        group = (_ofsmGroups)[i];
+        _OFSM_SNAPSHOT_FIELD(uint8_t, group->flags);
+        _OFSM_SNAPSHOT_FIELD(OFSM_CONFIG_INDEX_TYPE, group->nextEventIndex);
+        _OFSM_SNAPSHOT_FIELD(OFSM_CONFIG_INDEX_TYPE, group->currentEventIndex);
+        _OFSM_SNAPSHOT_ARRAY(group->eventQueue, group->eventQueueSize * sizeof(OFSMEventData));
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+        for (k = 0; k < group->eventQueueSize; k++) {
+            _OFSM_SNAPSHOT_FIELD(uint64_t, (group->eventQueueSequence)[k]);
+            _OFSM_SNAPSHOT_FIELD(uint8_t, (group->eventQueueCellLock)[k]);
+        }
+        _OFSM_SNAPSHOT_FIELD(uint64_t, group->eventQueueHead);
+        _OFSM_SNAPSHOT_FIELD(uint64_t, group->eventQueueTail);
+#endif
+#ifdef _OFSM_GROUP_SUMMARY_CACHE
+        _OFSM_SNAPSHOT_FIELD(_OFSM_TIME_DATA_TYPE, group->earliestWakeupTime);
+        _OFSM_SNAPSHOT_FIELD(uint8_t, group->andedFsmFlags);
+#endif
+#ifdef OFSM_CONFIG_FSM_POOL
+        if (group->pool) {
+            _OFSM_SNAPSHOT_ARRAY(group->pool->currentState, group->groupSize * sizeof(OFSM_CONFIG_INDEX_TYPE));
+            _OFSM_SNAPSHOT_ARRAY(group->pool->flags, group->groupSize * sizeof(uint8_t));
+            _OFSM_SNAPSHOT_ARRAY(group->pool->wakeupTime, group->groupSize * sizeof(_OFSM_TIME_DATA_TYPE));
+            _OFSM_SNAPSHOT_ARRAY(group->pool->skipNextEventCode, group->groupSize * sizeof(OFSM_CONFIG_INDEX_TYPE));
+            continue;
+        }
+#endif
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+        _OFSM_SNAPSHOT_ARRAY(group->wakeupIndexHeap, group->groupSize * sizeof(OFSM_CONFIG_INDEX_TYPE));
+        _OFSM_SNAPSHOT_ARRAY(group->wakeupIndexPosition, group->groupSize * sizeof(OFSM_CONFIG_INDEX_TYPE));
+        _OFSM_SNAPSHOT_ARRAY(group->wakeupIndexFsmFlags, group->groupSize * sizeof(uint8_t));
+        _OFSM_SNAPSHOT_FIELD(OFSM_CONFIG_INDEX_TYPE, group->wakeupIndexSize);
+        _OFSM_SNAPSHOT_FIELD(OFSM_CONFIG_INDEX_TYPE, group->wakeupIndexNoDeepSleepCount);
+#endif
+        for (k = 0; k < group->groupSize; k++) {
+            fsm = (group->fsms)[k];
+            _OFSM_SNAPSHOT_FIELD(uint8_t, fsm->flags);
+            _OFSM_SNAPSHOT_FIELD(_OFSM_TIME_DATA_TYPE, fsm->wakeupTime);
+            _OFSM_SNAPSHOT_FIELD(OFSM_CONFIG_INDEX_TYPE, fsm->currentState);
+            _OFSM_SNAPSHOT_FIELD(OFSM_CONFIG_INDEX_TYPE, fsm->skipNextEventCode);
+        }
+    }
+    return pos;
+}/*_ofsm_snapshot_walk*/
+
+uint32_t ofsm_snapshot_size()
+{
+    uint32_t size = 0;
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        size = _ofsm_snapshot_walk(NULL, _OFSM_SNAPSHOT_SIZE);
+    }
+    return size;
+}/*ofsm_snapshot_size*/
+
+uint32_t ofsm_snapshot_save(uint8_t *buffer, uint32_t bufferSize)
+{
+    uint32_t size = 0;
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        size = _ofsm_snapshot_walk(NULL, _OFSM_SNAPSHOT_SIZE);
+        if (size <= bufferSize) {
+            _ofsm_snapshot_walk(buffer, _OFSM_SNAPSHOT_SAVE);
+        }
+        else {
+            size = 0;
+        }
+    }
+    return size;
+}/*ofsm_snapshot_save*/
+
+bool ofsm_snapshot_restore(const uint8_t *buffer, uint32_t size)
+{
+    bool restored = false;
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        if (size == _ofsm_snapshot_walk(NULL, _OFSM_SNAPSHOT_SIZE)) {
+            restored = (0 != _ofsm_snapshot_walk((uint8_t*)buffer, _OFSM_SNAPSHOT_RESTORE));
+        }
+    }
+    return restored;
+}/*ofsm_snapshot_restore*/
+#endif /*OFSM_CONFIG_SNAPSHOT*/
+
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+/*------------------------------------------------
+Lock-free event queue (simulation only): bounded multi-producer/single-consumer ring.
+eventQueueTail/eventQueueHead count events claimed by producers/taken by ofsm, event n lives in cell (n % eventQueueSize).
+Producers claim cells by compare-and-swap on the tail and never wait for each other or for simulation mutex.
+Cell lock is only taken by ofsm while copying the event out and by producer that replaces data of the last queued event.
+Group is in buffer overflow state while (tail - head) == eventQueueSize.
+-------------------------------------------------*/
+static void _ofsm_simulation_lock_free_queue_reset(OFSMGroup *group)
+{
+    OFSM_CONFIG_INDEX_TYPE i;
+    for (i = 0; i < group->eventQueueSize; i++) {
+        (group->eventQueueSequence)[i].store(i);
+        (group->eventQueueCellLock)[i].store(0);
+    }
+    group->eventQueueHead.store(0);
+    group->eventQueueTail.store(0);
+}/*_ofsm_simulation_lock_free_queue_reset*/
+
+static OFSM_CONFIG_INDEX_TYPE _ofsm_simulation_lock_free_queue_pending_count(OFSMGroup *group)
+{
+    /*head first: it never passes the tail read afterwards*/
+    uint64_t head = group->eventQueueHead.load();
+    return (OFSM_CONFIG_INDEX_TYPE)(group->eventQueueTail.load() - head);
+}/*_ofsm_simulation_lock_free_queue_pending_count*/
+
+/*replace data of the last queued event, unless event codes are different or the event is taken by ofsm.
+Returns: 1 - replaced, 0 - can't be replaced, -1 - queue was modified concurrently, try again*/
+static int8_t _ofsm_simulation_lock_free_queue_replace_last(OFSMGroup *group, uint64_t tail, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData)
+{
+    uint64_t last = tail - 1;
+    OFSM_CONFIG_INDEX_TYPE cell = (OFSM_CONFIG_INDEX_TYPE)(last % group->eventQueueSize);
+    int8_t result = 0;
+
+    if (0 == tail) {
+        return 0; /*nothing has been queued yet*/
+    }
+    _OFSM_LOCK_FREE_QUEUE_CELL_LOCK(group, cell);
+    if (group->eventQueueTail.load() != tail) {
+        result = -1; /*another event is queued meanwhile*/
+    }
+    else if (group->eventQueueHead.load() > last) {
+        result = 0; /*taken by ofsm*/
+    }
+    else if ((group->eventQueueSequence)[cell].load(std::memory_order_acquire) != tail) {
+        result = -1; /*claimed, but not published yet*/
+    }
+    else if ((group->eventQueue)[cell].eventCode == eventCode) {
+#ifdef OFSM_CONFIG_SUPPORT_EVENT_DATA
+        (group->eventQueue)[cell].eventData = eventData;
+#endif
+        result = 1;
+    }
+    _OFSM_LOCK_FREE_QUEUE_CELL_UNLOCK(group, cell);
+    return result;
+}/*_ofsm_simulation_lock_free_queue_replace_last*/
+
+/*same queuing rules as in locked version of _ofsm_queue_group_event().
+Returns: 0 - event dropped (buffer overflow), 1 - new event queued, 2 - data of the last queued event replaced*/
+static uint8_t _ofsm_simulation_lock_free_queue_push(OFSMGroup *group, bool forceNewEvent, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData)
+{
+    uint64_t head, tail;
+    OFSM_CONFIG_INDEX_TYPE cell;
+    int8_t replaced;
+    bool force;
+    bool overflow;
+
+    while (1) {
+        head = group->eventQueueHead.load();
+        tail = group->eventQueueTail.load();
+        overflow = (tail - head >= group->eventQueueSize);
+        force = forceNewEvent;
+        if (!overflow) {
+            if (tail == head) {
+                force = true; /*all event are processed by FSM and event should never reuse previous event slot.*/
+            }
+            else if (0 == eventCode) {
+                force = false; /*always replace timeout event*/
+            }
+        }
+
+        if (!force) {
+            replaced = _ofsm_simulation_lock_free_queue_replace_last(group, tail, eventCode, eventData);
+            if (replaced > 0) {
+                return 2;
+            }
+            if (replaced < 0) {
+                std::this_thread::yield();
+                continue;
+            }
+        }
+
+        if (overflow) {
+            return 0;
+        }
+
+        cell = (OFSM_CONFIG_INDEX_TYPE)(tail % group->eventQueueSize);
+        if ((group->eventQueueSequence)[cell].load(std::memory_order_acquire) == tail
+            && group->eventQueueTail.compare_exchange_weak(tail, tail + 1)) {
+            (group->eventQueue)[cell].eventCode = eventCode;
+#ifdef OFSM_CONFIG_SUPPORT_EVENT_DATA
+            (group->eventQueue)[cell].eventData = eventData;
+#endif
+            (group->eventQueueSequence)[cell].store(tail + 1, std::memory_order_release);
+            return 1;
+        }
+        /*cell is claimed by another producer or is not released by ofsm yet; start over*/
+    }
+}/*_ofsm_simulation_lock_free_queue_push*/
+
+/*single consumer (ofsm), returns false if queue is empty or the oldest event is not published yet*/
+static bool _ofsm_simulation_lock_free_queue_pop(OFSMGroup *group, OFSMEventData *e)
 {
-    OFSMTransition *t;
+    uint64_t head = group->eventQueueHead.load(std::memory_order_relaxed);
+    OFSM_CONFIG_INDEX_TYPE cell = (OFSM_CONFIG_INDEX_TYPE)(head % group->eventQueueSize);
+
+    if ((group->eventQueueSequence)[cell].load(std::memory_order_acquire) != head + 1) {
+        return false;
+    }
+    _OFSM_LOCK_FREE_QUEUE_CELL_LOCK(group, cell);
+    *e = (group->eventQueue)[cell];
+    (group->eventQueueSequence)[cell].store(head + group->eventQueueSize, std::memory_order_release);
+    group->eventQueueHead.store(head + 1);
+    _OFSM_LOCK_FREE_QUEUE_CELL_UNLOCK(group, cell);
+    return true;
+}/*_ofsm_simulation_lock_free_queue_pop*/
+#endif /*OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE*/
+
+static inline uint8_t _ofsm_fsm_process_event(OFSM *fsm, OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSMEventData *e)
+{
+    OFSMTransition t;
     uint8_t oldFlags;
     _OFSM_TIME_DATA_TYPE oldWakeupTime;
     uint8_t wakeupTimeGTcurrentTime;
     OFSMState fsmState;
     _OFSM_TIME_DATA_TYPE currentTime;
     uint8_t timeFlags;
+#ifdef OFSM_CONFIG_PROFILING
+    uint32_t profileStart;
+    OFSM_CONFIG_INDEX_TYPE profileState;
+#endif
 
 #ifdef OFSM_CONFIG_SIMULATION
     long delay = -1;
@@ -43,22 +926,22 @@ static inline void _ofsm_fsm_process_event(OFSM *fsm, uint8_t groupIndex, uint8_
 
     if (e->eventCode >= fsm->transitionTableEventCount) {
         _ofsm_debug_printf(1,  "F(%i)G(%i): Unexpected Event!!! Ignored eventCode %i.\n", fsmIndex, groupIndex, e->eventCode);
-        return;
+        return 0;
     }
 
     if(e->eventCode == fsm->skipNextEventCode) {
-        fsm->skipNextEventCode = (uint8_t)-1; /*reset skip event*/
+        fsm->skipNextEventCode = (OFSM_CONFIG_INDEX_TYPE)-1; /*reset skip event*/
         _ofsm_debug_printf(1,  "F(%i)G(%i): eventCode %i is set to be skipped for this FSM instance.\n", fsmIndex, groupIndex, e->eventCode);
-        return;
+        return 0;
     }
 
     ofsm_get_time(currentTime, timeFlags);
 
     //check if wake time has been reached, wake up immediately if not timeout event, ignore non-handled   events.
-    t = _OFSM_GET_TRANSTION(fsm, e->eventCode);
+    _ofsm_fsm_get_transition(fsm, fsm->currentState, e->eventCode, &t);
     wakeupTimeGTcurrentTime = _OFSM_TIME_A_GT_B(fsm->wakeupTime, (fsm->flags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW), currentTime, (timeFlags & _OFSM_FLAG_OFSM_TIMER_OVERFLOW));
-    if (!t->eventHandler || (0 == e->eventCode && (((fsm->flags & _OFSM_FLAG_INFINITE_SLEEP) && !(_ofsmFlags & _OFSM_FLAG_OFSM_FIRST_ITERATION)) || wakeupTimeGTcurrentTime))) {
-        if (!t->eventHandler) {
+    if (!t.eventHandler || (0 == e->eventCode && (((fsm->flags & _OFSM_FLAG_INFINITE_SLEEP) && !(_ofsmFlags & _OFSM_FLAG_OFSM_FIRST_ITERATION)) || wakeupTimeGTcurrentTime))) {
+        if (!t.eventHandler) {
 #ifdef OFSM_CONFIG_SIMULATION
             _ofsm_debug_printf(4,  "F(%i)G(%i): Handler is not specified, state %i event code %i. Event is ignored.\n", fsmIndex, groupIndex, fsm->currentState, e->eventCode);
         }
@@ -69,7 +952,7 @@ static inline void _ofsm_fsm_process_event(OFSM *fsm, uint8_t groupIndex, uint8_
             _ofsm_debug_printf(4,  "F(%i)G(%i): State Machine is asleep. Wakeup is scheduled in %lu ticks.\n", fsmIndex, groupIndex, (long unsigned int)(fsm->wakeupTime - currentTime));
 #endif
         }
-        return;
+        return 0;
     }
 
 #ifdef OFSM_CONFIG_SUPPORT_EVENT_DATA
@@ -78,12 +961,14 @@ static inline void _ofsm_fsm_process_event(OFSM *fsm, uint8_t groupIndex, uint8_
     _ofsm_debug_printf(2,  "F(%i)G(%i): State: %i. Processing eventCode %i...\n", fsmIndex, groupIndex, fsm->currentState, e->eventCode);
 #endif
 
+    _OFSM_TRACE(_OFSM_TRACE_DISPATCH, groupIndex, fsmIndex, e->eventCode, 0, fsm->currentState);
+
     oldFlags = fsm->flags;
     oldWakeupTime = fsm->wakeupTime;
     fsm->wakeupTime = 0;
     fsm->flags &= ~_OFSM_FLAG_FSM_FLAG_ALL; //clear flags
 
-    if(t->eventHandler != OFSM_NOP_HANDLER) {
+    if(t.eventHandler != OFSM_NOP_HANDLER) {
         //call handler
         fsmState.fsm = fsm;
         fsmState.e = e;
@@ -99,33 +984,41 @@ static inline void _ofsm_fsm_process_event(OFSM *fsm, uint8_t groupIndex, uint8_
             }
         }
         _ofsmCurrentFsmState = &fsmState;
-        (t->eventHandler)();
+#ifdef OFSM_CONFIG_PROFILING
+        profileState = fsm->currentState; /*handler may override next state*/
+        profileStart = OFSM_CONFIG_CUSTOM_PROFILING_CLOCK_FUNC();
+#endif
+        (t.eventHandler)();
+#ifdef OFSM_CONFIG_PROFILING
+        _ofsm_profile_record(groupIndex, fsmIndex, profileState, e->eventCode, (uint32_t)(OFSM_CONFIG_CUSTOM_PROFILING_CLOCK_FUNC() - profileStart), !(fsm->flags & _OFSM_FLAG_FSM_PREVENT_TRANSITION));
+#endif
 
         //check if transition prevention was requested, restore original FSM state
         if (fsm->flags & _OFSM_FLAG_FSM_PREVENT_TRANSITION) {
             fsm->flags = oldFlags | _OFSM_FLAG_FSM_PREVENT_TRANSITION;
             fsm->wakeupTime = oldWakeupTime;
             _ofsm_debug_printf(3,  "F(%i)G(%i): Handler requested no transition. FSM state was restored.\n", fsmIndex, groupIndex);
-            return;
+            return 0;
         }
     }
 
     /*make a transition*/
-#ifdef OFSM_CONFIG_SIMULATION
-    uint8_t prevState = fsm->currentState;
+#if defined(OFSM_CONFIG_SIMULATION) || defined(OFSM_CONFIG_TRACE_BUFFER_SIZE)
+    OFSM_CONFIG_INDEX_TYPE prevState = fsm->currentState;
 #endif
     if (!(fsm->flags & _OFSM_FLAG_FSM_NEXT_STATE_OVERRIDE)) {
-        fsm->currentState = t->newState;
+        fsm->currentState = t.newState;
     }
 #ifdef OFSM_CONFIG_SIMULATION
     else {
         overridenState = '!';
     }
 #endif
+    _OFSM_TRACE(_OFSM_TRACE_TRANSITION, groupIndex, fsmIndex, e->eventCode, 0, ((uint32_t)(uint16_t)prevState << 16) | (uint16_t)fsm->currentState);
 
     /*check transition delay, assume infinite sleep if new state doesn't accept Timeout Event*/
-    t = _OFSM_GET_TRANSTION(fsm, 0);
-    if (!t->eventHandler) {
+    _ofsm_fsm_get_transition(fsm, fsm->currentState, 0, &t);
+    if (!t.eventHandler) {
         fsm->flags |= _OFSM_FLAG_INFINITE_SLEEP; /*set infinite sleep*/
 #ifdef OFSM_CONFIG_SIMULATION
         delay = -1;
@@ -142,23 +1035,110 @@ static inline void _ofsm_fsm_process_event(OFSM *fsm, uint8_t groupIndex, uint8_
         delay = fsm->wakeupTime;
 #endif
         fsm->wakeupTime += currentTime;
-        if (fsm->wakeupTime < currentTime) {
-            fsm->flags |= _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW;
-        }
     }
+#ifndef OFSM_CONFIG_WIDE_TIME
+    /*wakeup time is in the epoch of current time, unless it wraps*/
+    if (!(fsm->flags & _OFSM_FLAG_INFINITE_SLEEP) && (!(timeFlags & _OFSM_FLAG_OFSM_TIMER_OVERFLOW) != !(fsm->wakeupTime < currentTime))) {
+        fsm->flags |= _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW;
+    }
+#endif
+    _OFSM_TRACE(_OFSM_TRACE_DELAY, groupIndex, fsmIndex, fsm->currentState, 0, (fsm->flags & _OFSM_FLAG_INFINITE_SLEEP ? _OFSM_TRACE_INFINITE : (uint32_t)(fsm->wakeupTime - currentTime)));
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+#   ifdef OFSM_CONFIG_FSM_POOL
+    if (!(_ofsmGroups[groupIndex]->pool))
+#   endif
+    _ofsm_wakeup_index_update(_ofsmGroups[groupIndex], fsmIndex);
+#endif
     _ofsm_debug_printf(2,  "F(%i)G(%i): Transitioning from state %i ==> %c%i. Transition delay: %ld\n", fsmIndex, groupIndex,  prevState, overridenState, fsm->currentState, delay);
+
+    /*timeout of the new state is due right away*/
+    return (!(fsm->flags & _OFSM_FLAG_INFINITE_SLEEP) && fsm->wakeupTime == currentTime);
 }/*_ofsm_fsm_process_event*/
 
-static inline void _ofsm_group_process_pending_event(OFSMGroup *group, uint8_t groupIndex, _OFSM_TIME_DATA_TYPE *groupEarliestWakeupTime, uint8_t *groupAndedFsmFlags)
+#ifdef OFSM_CONFIG_RUN_TO_COMPLETION_DEPTH
+/*process event; while new state's timeout is due right away, process the timeout in place (up to OFSM_CONFIG_RUN_TO_COMPLETION_DEPTH times),
+instead of broadcasting timeout event to all groups from the main loop*/
+static inline void _ofsm_fsm_run_to_completion(OFSM *fsm, OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex, OFSMEventData *e)
+{
+    OFSMEventData timeoutEvent;
+    uint8_t depth = 0;
+
+    if (!_ofsm_fsm_process_event(fsm, groupIndex, fsmIndex, e)) {
+        return;
+    }
+    timeoutEvent.eventCode = 0;
+#ifdef OFSM_CONFIG_SUPPORT_EVENT_DATA
+    timeoutEvent.eventData = 0;
+#endif
+    while (depth < OFSM_CONFIG_RUN_TO_COMPLETION_DEPTH) {
+        depth++;
+        _ofsm_debug_printf(3,  "F(%i)G(%i): Run to completion, depth %i.\n", fsmIndex, groupIndex, depth);
+        if (!_ofsm_fsm_process_event(fsm, groupIndex, fsmIndex, &timeoutEvent)) {
+            break;
+        }
+    }
+    /*if still due, main loop queues timeout event as usual*/
+}/*_ofsm_fsm_run_to_completion*/
+#endif /*OFSM_CONFIG_RUN_TO_COMPLETION_DEPTH*/
+
+static inline void _ofsm_group_process_pending_event(OFSMGroup *group, OFSM_CONFIG_INDEX_TYPE groupIndex, _OFSM_TIME_DATA_TYPE *groupEarliestWakeupTime, uint8_t *groupAndedFsmFlags)
 {
     OFSMEventData e;
     OFSM *fsm;
 	uint8_t andedFsmFlags = (uint8_t)0xFFFF;
-    _OFSM_TIME_DATA_TYPE earliestWakeupTime = 0xFFFFFFFF;
-    uint8_t i;
+    _OFSM_TIME_DATA_TYPE earliestWakeupTime = (_OFSM_TIME_DATA_TYPE)-1;
+    OFSM_CONFIG_INDEX_TYPE i;
     uint8_t eventPending = 1;
+#ifdef OFSM_CONFIG_EVENT_BATCH_SIZE
+    OFSMEventData batch[OFSM_CONFIG_EVENT_BATCH_SIZE];
+    uint8_t batchCount = 0;
+    uint8_t k;
+#endif
 
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+#   ifdef OFSM_CONFIG_EVENT_BATCH_SIZE
+    while (batchCount < OFSM_CONFIG_EVENT_BATCH_SIZE && _ofsm_simulation_lock_free_queue_pop(group, &(batch[batchCount]))) {
+        batchCount++;
+    }
+    eventPending = batchCount;
+#   else
+    eventPending = _ofsm_simulation_lock_free_queue_pop(group, &e);
+#   endif
+#   ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+    /*clear before checking the queue: producer sets the bit after its event is claimed, so the bit can't be lost*/
+    if (!_ofsm_simulation_lock_free_queue_pending_count(group)) {
+        _OFSM_PENDING_GROUP_CLEAR(groupIndex);
+    }
+#   endif
+    /*also covers event that is claimed, but not published yet*/
+    if (_ofsm_simulation_lock_free_queue_pending_count(group)) {
+        _ofsmFlags |= _OFSM_FLAG_OFSM_EVENT_QUEUED;
+#   ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+        _OFSM_PENDING_GROUP_SET(groupIndex);
+#   endif
+    }
+#else
     OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+#   ifdef OFSM_CONFIG_EVENT_BATCH_SIZE
+        /*copy up to OFSM_CONFIG_EVENT_BATCH_SIZE events within single critical section*/
+        while (batchCount < OFSM_CONFIG_EVENT_BATCH_SIZE
+            && (group->currentEventIndex != group->nextEventIndex || (group->flags & _OFSM_FLAG_GROUP_BUFFER_OVERFLOW))) {
+            batch[batchCount++] = ((group->eventQueue)[group->currentEventIndex]);
+
+            group->currentEventIndex++;
+            if (group->currentEventIndex == group->eventQueueSize) {
+                group->currentEventIndex = 0;
+            }
+
+            group->flags &= ~_OFSM_FLAG_GROUP_BUFFER_OVERFLOW; //clear buffer overflow
+        }
+        eventPending = batchCount;
+
+        /*set: other events pending if nextEventIdex points further in the queue */
+        if (group->currentEventIndex != group->nextEventIndex) {
+            _ofsmFlags |= _OFSM_FLAG_OFSM_EVENT_QUEUED;
+        }
+#   else
         if (group->currentEventIndex == group->nextEventIndex && !(group->flags & _OFSM_FLAG_GROUP_BUFFER_OVERFLOW)) {
             eventPending = 0;
         }
@@ -178,52 +1158,569 @@ static inline void _ofsm_group_process_pending_event(OFSMGroup *group, uint8_t g
                 _ofsmFlags |= _OFSM_FLAG_OFSM_EVENT_QUEUED;
             }
         }
+#   endif /*OFSM_CONFIG_EVENT_BATCH_SIZE*/
+#ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+        /*last event is taken, group doesn't need to be visited again until new event gets queued*/
+        if (group->currentEventIndex == group->nextEventIndex) {
+            _OFSM_PENDING_GROUP_CLEAR(groupIndex);
+        }
+#endif
     }
 
     _ofsm_debug_printf(4,  "G(%i): currentEventIndex %i, nextEventIndex %i.\n", groupIndex, group->currentEventIndex, group->nextEventIndex);
+#endif /*OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE*/
 
     //Queue considered empty when (nextEventIndex == currentEventIndex) and buffer overflow flag is NOT set
     if (!eventPending) {
         _ofsm_debug_printf(4,  "G(%i): Event queue is empty.\n", groupIndex);
     }
 
-    //iterate over fsms
-    for (i = 0; i < group->groupSize; i++) {
-        fsm = (group->fsms)[i];
-        //if queue is empty don't call fsm just collect info
-        if (eventPending) {
-            _ofsm_fsm_process_event(fsm, groupIndex, i, &e);
+#ifdef OFSM_CONFIG_EVENT_BATCH_SIZE
+    /*dispatch the batch: each event goes to all group fsms before the next one; wakeup summary is collected once below*/
+    for (k = 0; k < batchCount; k++) {
+        for (i = 0; i < group->groupSize; i++) {
+            fsm = _OFSM_GROUP_FSM_LOAD(group, i);
+            if (_OFSM_FSM_ACCEPTS_EVENT(fsm, batch[k].eventCode)) {
+                _OFSM_FSM_PROCESS_EVENT(fsm, groupIndex, i, &(batch[k]));
+                _OFSM_GROUP_FSM_STORE(group, i);
+            }
+        }
+    }
+    eventPending = 0;
+#endif
+
+#ifdef OFSM_CONFIG_FSM_POOL
+    if (group->pool) {
+        OFSMPool *pool = group->pool;
+        uint8_t fsmFlags;
+#   ifdef OFSM_CONFIG_SIMD_TIMEOUT_SWEEP
+        if (!eventPending || e.eventCode == 0) {
+            _ofsm_pool_timeout_sweep(group, groupIndex, (eventPending ? &e : NULL), &earliestWakeupTime, &andedFsmFlags);
+            *groupEarliestWakeupTime = earliestWakeupTime;
+            *groupAndedFsmFlags  = andedFsmFlags;
+            return;
+        }
+#   endif
+        //iterate over pool instances: wakeup summary streams through per instance arrays
+        for (i = 0; i < group->groupSize; i++) {
+            if (eventPending) {
+                fsm = _ofsm_group_fsm_load(group, i);
+                if (_OFSM_FSM_ACCEPTS_EVENT(fsm, e.eventCode)) {
+                    _OFSM_FSM_PROCESS_EVENT(fsm, groupIndex, i, &e);
+                    _ofsm_group_fsm_store(group, i);
+                }
+            }
+
+            fsmFlags = (pool->flags)[i];
+            _OFSM_WAKEUP_FOLD(earliestWakeupTime, andedFsmFlags, (pool->wakeupTime)[i], fsmFlags);
+        }
+        *groupEarliestWakeupTime = earliestWakeupTime;
+        *groupAndedFsmFlags  = andedFsmFlags;
+        return;
+    }
+#endif
+
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+    if (eventPending) {
+        for (i = 0; i < group->groupSize; i++) {
+            fsm = (group->fsms)[i];
+            if (_OFSM_FSM_ACCEPTS_EVENT(fsm, e.eventCode)) {
+                _OFSM_FSM_PROCESS_EVENT(fsm, groupIndex, i, &e);
+            }
+        }
+    }
+
+    /*earliest wakeup time is on top of the index, no need to walk through fsms.
+    When all fsms are in infinite sleep, report scheduled time overflow too, so that the group doesn't affect overflow flag of other groups*/
+    andedFsmFlags = (_OFSM_FLAG_INFINITE_SLEEP | _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW);
+    if (group->wakeupIndexSize) {
+        fsm = (group->fsms)[(group->wakeupIndexHeap)[0]];
+        earliestWakeupTime = fsm->wakeupTime;
+        andedFsmFlags = (fsm->flags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW);
+    }
+    if (!group->wakeupIndexNoDeepSleepCount) {
+        andedFsmFlags |= _OFSM_FLAG_ALLOW_DEEP_SLEEP;
+    }
+#else
+    //iterate over fsms
+    for (i = 0; i < group->groupSize; i++) {
+        fsm = (group->fsms)[i];
+        //if queue is empty don't call fsm just collect info
+        if (eventPending && _OFSM_FSM_ACCEPTS_EVENT(fsm, e.eventCode)) {
+            _OFSM_FSM_PROCESS_EVENT(fsm, groupIndex, i, &e);
+        }
+
+        //Take sleep period unless infinite sleep
+        _OFSM_WAKEUP_FOLD(earliestWakeupTime, andedFsmFlags, fsm->wakeupTime, fsm->flags);
+    }
+#endif /*OFSM_CONFIG_WAKEUP_INDEX*/
+
+    *groupEarliestWakeupTime = earliestWakeupTime;
+    *groupAndedFsmFlags  = andedFsmFlags;
+}/*_ofsm_group_process_pending_event*/
+
+#ifdef OFSM_CONFIG_SIMULATION
+/*------------------------------------------------
+Groups built at run time (OFSM_SETUP_GROUPS()) may leave arrays of enabled options NULL: they are allocated by setup.
+Allocated arrays are kept, setup of the same groups again reuses them.
+-------------------------------------------------*/
+#   ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+static void _ofsm_simulation_fsm_alloc(OFSM *fsm)
+{
+    /*mask can only be built when number of states is known, fsm without mask accepts every event*/
+    if (!fsm->eventInterestMask && fsm->transitionTableStateCount) {
+        fsm->eventInterestMask = new uint8_t[(unsigned long)fsm->transitionTableStateCount * _OFSM_EVENT_INTEREST_MASK_STRIDE(fsm)];
+    }
+}/*_ofsm_simulation_fsm_alloc*/
+#   endif
+
+static void _ofsm_simulation_group_alloc(OFSMGroup *group)
+{
+#   ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+    OFSM_CONFIG_INDEX_TYPE i;
+#   endif
+#   ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+    if (!group->eventQueueSequence) {
+        group->eventQueueSequence = new std::atomic<uint64_t>[group->eventQueueSize];
+    }
+    if (!group->eventQueueCellLock) {
+        group->eventQueueCellLock = new std::atomic<uint8_t>[group->eventQueueSize];
+    }
+#   endif
+#   ifdef OFSM_CONFIG_FSM_POOL
+    OFSMPool *pool = group->pool;
+    if (pool) {
+        if (!pool->currentState) {
+            pool->currentState = new OFSM_CONFIG_INDEX_TYPE[group->groupSize];
+        }
+        if (!pool->flags) {
+            pool->flags = new uint8_t[group->groupSize];
+        }
+        if (!pool->wakeupTime) {
+            pool->wakeupTime = new _OFSM_TIME_DATA_TYPE[group->groupSize];
+        }
+        if (!pool->skipNextEventCode) {
+            pool->skipNextEventCode = new OFSM_CONFIG_INDEX_TYPE[group->groupSize];
+        }
+#       ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+        _ofsm_simulation_fsm_alloc(pool->fsm);
+#       endif
+        return;
+    }
+#   endif
+#   ifdef OFSM_CONFIG_WAKEUP_INDEX
+    if (!group->wakeupIndexHeap) {
+        group->wakeupIndexHeap = new OFSM_CONFIG_INDEX_TYPE[group->groupSize]();
+    }
+    if (!group->wakeupIndexPosition) {
+        group->wakeupIndexPosition = new OFSM_CONFIG_INDEX_TYPE[group->groupSize]();
+    }
+    if (!group->wakeupIndexFsmFlags) {
+        group->wakeupIndexFsmFlags = new uint8_t[group->groupSize]();
+    }
+#   endif
+#   ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+    for (i = 0; i < group->groupSize; i++) {
+        _ofsm_simulation_fsm_alloc((group->fsms)[i]);
+    }
+#   endif
+}/*_ofsm_simulation_group_alloc*/
+
+#   ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+/*bitmap of groups set up at run time; the one of the previous setup is reused when it is large enough*/
+void _ofsm_simulation_setup_pending_group_bitmap(OFSM_CONFIG_INDEX_TYPE groupCount)
+{
+    uint32_t size = ((uint32_t)groupCount + 7) >> 3;
+    uint32_t i;
+    if (size > _ofsmSimulationPendingGroupsSize) {
+        delete[] _ofsmSimulationPendingGroups;
+        _ofsmSimulationPendingGroups = new _OFSM_PENDING_GROUP_DATA_TYPE[size]();
+        _ofsmSimulationPendingGroupsSize = size;
+    }
+    for (i = 0; i < size; i++) {
+        _ofsmSimulationPendingGroups[i] = 0;
+    }
+    _ofsmPendingGroups = _ofsmSimulationPendingGroups;
+}/*_ofsm_simulation_setup_pending_group_bitmap*/
+#   endif
+#endif /*OFSM_CONFIG_SIMULATION*/
+
+#ifdef OFSM_CONFIG_SIMULATION_WORKER_THREADS
+/*------------------------------------------------
+Worker pool: groups that need processing are dispatched concurrently to OFSM_CONFIG_SIMULATION_WORKER_THREADS threads (ofsm thread takes part as well).
+Each group is claimed by exactly one thread at a time, so that its fsms are never accessed concurrently.
+Group wakeup summary is cached in the group and merged by ofsm thread once all scheduled groups are processed.
+-------------------------------------------------*/
+#   ifdef OFSM_CONFIG_SIMULATION_WORK_STEALING
+#       define _OFSM_SIMULATION_WORK_DEQUE_COUNT (OFSM_CONFIG_SIMULATION_WORKER_THREADS + 1) /*deque 0 belongs to ofsm thread*/
+
+/*ring deque of ready groups: owner pushes and pops at the back, thieves take from the front.
+Group sits in at most one deque at a time (see scheduled[]), so (group count + 1) cells never overflow*/
+struct _OFSMSimulationWorkDeque {
+    std::mutex              mutex;
+    OFSM_CONFIG_INDEX_TYPE* groups;
+    uint32_t                size;
+    uint32_t                head;
+    uint32_t                tail;
+};
+#   endif
+
+struct _OFSMSimulationWorkerPool {
+    std::mutex              mutex;
+    std::condition_variable roundStarted;   /*work stealing: group is ready*/
+    std::condition_variable roundCompleted;
+    bool                    started;
+#   ifdef OFSM_CONFIG_SIMULATION_WORK_STEALING
+    _OFSMSimulationWorkDeque deques[_OFSM_SIMULATION_WORK_DEQUE_COUNT];
+    std::atomic<bool>*      scheduled;      /*per group: group is in a deque or being processed*/
+    std::atomic<uint32_t>   groupCapacity;  /*groups scheduled[] and deques are sized for; 0 until setup*/
+    std::atomic<uint32_t>   schedulingThreads; /*threads inside _ofsm_simulation_worker_pool_schedule_group(), arrays are not resized while any*/
+    std::atomic<uint32_t>   readyGroups;    /*groups waiting in deques*/
+    std::atomic<uint32_t>   outstandingGroups; /*groups waiting in deques or being processed*/
+    std::atomic<uint8_t>    idleWorkers;
+    bool                    ofsmWaiting;    /*ofsm thread merges summaries once outstanding groups are processed*/
+#   else
+    uint32_t                round;
+    uint8_t                 busyWorkers;    /*workers that haven't completed current round yet*/
+    OFSM_CONFIG_INDEX_TYPE* groups;         /*indices of groups to be processed in current round*/
+    uint32_t                groupCapacity;  /*groups[] is sized for*/
+    uint32_t                groupCount;
+    std::atomic<uint32_t>   nextGroup;      /*next element of groups[] to be claimed*/
+#   endif
+};
+
+/*allocated on first use and never destroyed: detached workers keep waiting on its condition variable until process exits*/
+static _OFSMSimulationWorkerPool *_ofsm_simulation_worker_pool() {
+    static _OFSMSimulationWorkerPool *pool = new _OFSMSimulationWorkerPool();
+    return pool;
+}
+
+#   ifdef OFSM_CONFIG_SIMULATION_WORK_STEALING
+static thread_local _OFSMSimulationWorkDeque *_ofsmSimulationOwnWorkDeque; /*NULL in producer threads*/
+
+static inline bool _ofsm_simulation_group_has_pending_event(OFSMGroup *group) {
+    bool pending;
+#       ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+    pending = (_ofsm_simulation_lock_free_queue_pending_count(group) != 0);
+#       else
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        pending = (group->currentEventIndex != group->nextEventIndex || (group->flags & _OFSM_FLAG_GROUP_BUFFER_OVERFLOW));
+    }
+#       endif
+    return pending;
+}
+
+static void _ofsm_simulation_work_deque_push(_OFSMSimulationWorkDeque *deque, OFSM_CONFIG_INDEX_TYPE groupIndex) {
+    std::lock_guard<std::mutex> lk(deque->mutex);
+    (deque->groups)[deque->tail] = groupIndex;
+    deque->tail = (deque->tail + 1 == deque->size ? 0 : deque->tail + 1);
+}
+
+static bool _ofsm_simulation_work_deque_pop(_OFSMSimulationWorkDeque *deque, bool steal, OFSM_CONFIG_INDEX_TYPE *groupIndex) {
+    std::lock_guard<std::mutex> lk(deque->mutex);
+    if (deque->head == deque->tail) {
+        return false;
+    }
+    /*owner takes the group it has just pushed (e.g. rescheduled busy group), thief takes the oldest one*/
+    if (steal) {
+        *groupIndex = (deque->groups)[deque->head];
+        deque->head = (deque->head + 1 == deque->size ? 0 : deque->head + 1);
+    }
+    else {
+        deque->tail = (deque->tail == 0 ? deque->size : deque->tail) - 1;
+        *groupIndex = (deque->groups)[deque->tail];
+    }
+    return true;
+}
+
+/*groups scheduled before pool arrays are sized for them (e.g. producer queues events before setup) are dropped:
+events stay in group queue and first iteration of ofsm loop schedules every group*/
+static void _ofsm_simulation_worker_pool_schedule_group(OFSM_CONFIG_INDEX_TYPE groupIndex) {
+    _OFSMSimulationWorkerPool *pool = _ofsm_simulation_worker_pool();
+    _OFSMSimulationWorkDeque *deque = _ofsmSimulationOwnWorkDeque;
+    pool->schedulingThreads++;
+    if (groupIndex >= pool->groupCapacity || pool->scheduled[groupIndex].exchange(true)) {
+        pool->schedulingThreads--;
+        return; /*thread that processes the group re-checks its queue when done*/
+    }
+    pool->outstandingGroups++;
+    if (!deque) {
+        deque = &(pool->deques[groupIndex % _OFSM_SIMULATION_WORK_DEQUE_COUNT]);
+    }
+    _ofsm_simulation_work_deque_push(deque, groupIndex);
+    pool->schedulingThreads--;
+    pool->readyGroups++;
+    if (pool->idleWorkers) {
+        std::lock_guard<std::mutex> lk(pool->mutex);
+        pool->roundStarted.notify_one();
+    }
+}/*_ofsm_simulation_worker_pool_schedule_group*/
+
+/*own deque first, then steal from others*/
+static bool _ofsm_simulation_worker_pool_take_group(_OFSMSimulationWorkerPool *pool, OFSM_CONFIG_INDEX_TYPE *groupIndex) {
+    uint8_t own = (uint8_t)(_ofsmSimulationOwnWorkDeque - pool->deques);
+    uint8_t k;
+    if (!pool->readyGroups) {
+        return false;
+    }
+    for (k = 0; k < _OFSM_SIMULATION_WORK_DEQUE_COUNT; k++) {
+        if (_ofsm_simulation_work_deque_pop(&(pool->deques[(own + k) % _OFSM_SIMULATION_WORK_DEQUE_COUNT]), k != 0, groupIndex)) {
+            pool->readyGroups--;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void _ofsm_simulation_worker_pool_process_group(_OFSMSimulationWorkerPool *pool, OFSM_CONFIG_INDEX_TYPE groupIndex) {
+    OFSMGroup *group = (_ofsmGroups)[groupIndex];
+    _OFSM_TIME_DATA_TYPE earliestWakeupTime;
+    uint8_t andedFsmFlags;
+    bool notifyOfsm = false;
+
+    _ofsm_debug_printf(4,  "O: Processing event for group index %i...\n", groupIndex);
+    _ofsm_group_process_pending_event(group, groupIndex, &earliestWakeupTime, &andedFsmFlags);
+    {
+        std::lock_guard<std::mutex> lk(pool->mutex);
+        /*ofsm thread may have merged summaries already, it has to merge them again*/
+        notifyOfsm = (!pool->ofsmWaiting && (group->earliestWakeupTime != earliestWakeupTime || group->andedFsmFlags != andedFsmFlags));
+        group->earliestWakeupTime = earliestWakeupTime;
+        group->andedFsmFlags = andedFsmFlags;
+    }
+    pool->scheduled[groupIndex] = false;
+    if (_ofsm_simulation_group_has_pending_event(group)) {
+        _ofsm_simulation_worker_pool_schedule_group(groupIndex);
+    }
+    if (notifyOfsm) {
+        _ofsmFlags |= _OFSM_FLAG_OFSM_EVENT_QUEUED;
+        OFSM_CONFIG_CUSTOM_WAKEUP_FUNC();
+    }
+    if (0 == --pool->outstandingGroups) {
+        std::lock_guard<std::mutex> lk(pool->mutex);
+        pool->roundCompleted.notify_one();
+    }
+}/*_ofsm_simulation_worker_pool_process_group*/
+
+static void _ofsm_simulation_worker_thread(int dequeIndex) {
+    _OFSMSimulationWorkerPool *pool = _ofsm_simulation_worker_pool();
+    OFSM_CONFIG_INDEX_TYPE groupIndex;
+    _ofsmSimulationOwnWorkDeque = &(pool->deques[dequeIndex]);
+    while (1) {
+        while (_ofsm_simulation_worker_pool_take_group(pool, &groupIndex)) {
+            _ofsm_simulation_worker_pool_process_group(pool, groupIndex);
+        }
+        std::unique_lock<std::mutex> lk(pool->mutex);
+        /*announce idle before checking ready groups: either scheduler sees the announcement or worker sees the group*/
+        pool->idleWorkers++;
+        pool->roundStarted.wait(lk, [pool]() { return pool->readyGroups != 0; });
+        pool->idleWorkers--;
+    }
+}/*_ofsm_simulation_worker_thread*/
+
+static inline void _ofsm_simulation_worker_pool_add_group(OFSM_CONFIG_INDEX_TYPE groupIndex) {
+    _ofsm_simulation_worker_pool_schedule_group(groupIndex);
+}
+
+/*help with scheduled groups, then wait until all of them are processed; summaries are merged under pool mutex afterwards*/
+static void _ofsm_simulation_worker_pool_run() {
+    _OFSMSimulationWorkerPool *pool = _ofsm_simulation_worker_pool();
+    OFSM_CONFIG_INDEX_TYPE groupIndex;
+    _ofsmSimulationOwnWorkDeque = &(pool->deques[0]);
+    {
+        std::lock_guard<std::mutex> lk(pool->mutex);
+        pool->ofsmWaiting = true;
+    }
+    while (_ofsm_simulation_worker_pool_take_group(pool, &groupIndex)) {
+        _ofsm_simulation_worker_pool_process_group(pool, groupIndex);
+    }
+    std::unique_lock<std::mutex> lk(pool->mutex);
+    pool->roundCompleted.wait(lk, [pool]() { return 0 == pool->outstandingGroups; });
+    pool->ofsmWaiting = false;
+}/*_ofsm_simulation_worker_pool_run*/
+#   else
+static void _ofsm_simulation_worker_pool_process_groups(_OFSMSimulationWorkerPool *pool) {
+    uint32_t k;
+    OFSM_CONFIG_INDEX_TYPE i;
+    OFSMGroup *group;
+    while ((k = pool->nextGroup.fetch_add(1)) < pool->groupCount) {
+        i = pool->groups[k];
+        group = (_ofsmGroups)[i];
+        _ofsm_debug_printf(4,  "O: Processing event for group index %i...\n", i);
+        _ofsm_group_process_pending_event(group, i, &(group->earliestWakeupTime), &(group->andedFsmFlags));
+    }
+}
+
+static void _ofsm_simulation_worker_thread(int ignore) {
+    _OFSMSimulationWorkerPool *pool = _ofsm_simulation_worker_pool();
+    uint32_t round = 0;
+    while (1) {
+        {
+            std::unique_lock<std::mutex> lk(pool->mutex);
+            pool->roundStarted.wait(lk, [pool, &round]() { return pool->round != round; });
+            round = pool->round;
+        }
+        _ofsm_simulation_worker_pool_process_groups(pool);
+        {
+            std::lock_guard<std::mutex> lk(pool->mutex);
+            if (0 == --pool->busyWorkers) {
+                pool->roundCompleted.notify_one();
+            }
+        }
+    }
+}/*_ofsm_simulation_worker_thread*/
+
+static inline void _ofsm_simulation_worker_pool_add_group(OFSM_CONFIG_INDEX_TYPE groupIndex) {
+    _OFSMSimulationWorkerPool *pool = _ofsm_simulation_worker_pool();
+    pool->groups[pool->groupCount++] = groupIndex;
+}
+
+/*process added groups and wait until all of them are processed*/
+static void _ofsm_simulation_worker_pool_run() {
+    _OFSMSimulationWorkerPool *pool = _ofsm_simulation_worker_pool();
+    pool->nextGroup = 0;
+    if (pool->groupCount > 1) {
+        {
+            std::lock_guard<std::mutex> lk(pool->mutex);
+            pool->busyWorkers = OFSM_CONFIG_SIMULATION_WORKER_THREADS;
+            pool->round++;
+        }
+        pool->roundStarted.notify_all();
+        _ofsm_simulation_worker_pool_process_groups(pool);
+        std::unique_lock<std::mutex> lk(pool->mutex);
+        pool->roundCompleted.wait(lk, [pool]() { return 0 == pool->busyWorkers; });
+    }
+    else {
+        /*not worth waking up workers*/
+        _ofsm_simulation_worker_pool_process_groups(pool);
+    }
+    pool->groupCount = 0;
+}/*_ofsm_simulation_worker_pool_run*/
+#   endif /*OFSM_CONFIG_SIMULATION_WORK_STEALING*/
+
+/*sizes pool arrays for current group count; called by every setup, as groups set up later (OFSM_SETUP_GROUPS) may outnumber earlier ones.
+Arrays only grow; scheduled groups and queued indices are kept*/
+static void _ofsm_simulation_worker_pool_resize(_OFSMSimulationWorkerPool *pool) {
+    uint32_t capacity = (uint32_t)_ofsmGroupCount;
+    uint32_t k;
+#   ifdef OFSM_CONFIG_SIMULATION_WORK_STEALING
+    std::atomic<bool> *scheduled;
+    OFSM_CONFIG_INDEX_TYPE *groups;
+    _OFSMSimulationWorkDeque *deque;
+    uint8_t i;
+    if (capacity <= pool->groupCapacity) {
+        return;
+    }
+    /*stop scheduling and wait for threads that are already inside of it*/
+    k = pool->groupCapacity;
+    pool->groupCapacity = 0;
+    while (pool->schedulingThreads) {
+        std::this_thread::yield();
+    }
+    scheduled = new std::atomic<bool>[capacity]();
+    while (k--) {
+        scheduled[k] = pool->scheduled[k].load();
+    }
+    delete[] pool->scheduled;
+    pool->scheduled = scheduled;
+    for (i = 0; i < _OFSM_SIMULATION_WORK_DEQUE_COUNT; i++) {
+        deque = &(pool->deques[i]);
+        std::lock_guard<std::mutex> lk(deque->mutex);
+        groups = new OFSM_CONFIG_INDEX_TYPE[capacity + 1];
+        for (k = 0; deque->head != deque->tail; k++) {
+            groups[k] = (deque->groups)[deque->head];
+            deque->head = (deque->head + 1 == deque->size ? 0 : deque->head + 1);
+        }
+        delete[] deque->groups;
+        deque->groups = groups;
+        deque->size = capacity + 1;
+        deque->head = 0;
+        deque->tail = k;
+    }
+    pool->groupCapacity = capacity;
+#   else
+    if (capacity <= pool->groupCapacity) {
+        return;
+    }
+    /*only ofsm thread adds groups, and setup is not called from within a round*/
+    OFSM_CONFIG_INDEX_TYPE *groups = new OFSM_CONFIG_INDEX_TYPE[capacity];
+    for (k = 0; k < pool->groupCount; k++) {
+        groups[k] = (pool->groups)[k];
+    }
+    delete[] pool->groups;
+    pool->groups = groups;
+    pool->groupCapacity = capacity;
+#   endif
+}/*_ofsm_simulation_worker_pool_resize*/
+
+static void _ofsm_simulation_worker_pool_start() {
+    _OFSMSimulationWorkerPool *pool = _ofsm_simulation_worker_pool();
+    uint8_t i;
+    std::lock_guard<std::mutex> lk(pool->mutex);
+    _ofsm_simulation_worker_pool_resize(pool);
+    if (pool->started) {
+        return;
+    }
+    pool->started = true;
+    for (i = 0; i < OFSM_CONFIG_SIMULATION_WORKER_THREADS; i++) {
+        std::thread worker(_ofsm_simulation_worker_thread, i + 1);
+        worker.detach();
+    }
+}
+#endif /*OFSM_CONFIG_SIMULATION_WORKER_THREADS*/
+
+void _ofsm_setup() {
+#if defined(OFSM_CONFIG_SUPPORT_INITIALIZATION_HANDLER) || defined(OFSM_CONFIG_WAKEUP_INDEX) || defined(OFSM_CONFIG_EVENT_INTEREST_MASK) || defined(OFSM_CONFIG_PENDING_GROUP_BITMAP) || defined(OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE) || defined(OFSM_CONFIG_FSM_POOL) || defined(OFSM_CONFIG_SIMULATION)
+    OFSM_CONFIG_INDEX_TYPE i;
+#endif
+#ifdef OFSM_CONFIG_SIMULATION
+    for (i = 0; i < _ofsmGroupCount; i++) {
+        _ofsm_simulation_group_alloc((_ofsmGroups)[i]);
+    }
+#endif
+#ifdef OFSM_CONFIG_SIMULATION_WORKER_THREADS
+    _ofsm_simulation_worker_pool_start();
+#endif
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+    for (i = 0; i < _ofsmGroupCount; i++) {
+        _ofsm_simulation_lock_free_queue_reset((_ofsmGroups)[i]);
+    }
+#endif
+#ifdef OFSM_CONFIG_FSM_POOL
+    for (i = 0; i < _ofsmGroupCount; i++) {
+        if ((_ofsmGroups)[i]->pool) {
+            _ofsm_pool_reset((_ofsmGroups)[i]);
+        }
+    }
+#endif
+#ifdef OFSM_CONFIG_EVENT_INTEREST_MASK
+    OFSM_CONFIG_INDEX_TYPE j;
+
+    for (i = 0; i < _ofsmGroupCount; i++) {
+#   ifdef OFSM_CONFIG_FSM_POOL
+        /*pool instances share the mask*/
+        if ((_ofsmGroups)[i]->pool) {
+            _ofsm_fsm_build_event_interest_mask((_ofsmGroups)[i]->pool->fsm);
+            continue;
         }
-
-        //Take sleep period unless infinite sleep
-        if (!(fsm->flags & _OFSM_FLAG_INFINITE_SLEEP)) {
-            if(_OFSM_TIME_A_GT_B(earliestWakeupTime, (andedFsmFlags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW), fsm->wakeupTime, (fsm->flags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW))) {
-                earliestWakeupTime = fsm->wakeupTime;
-            }
+#   endif
+        for (j = 0; j < (_ofsmGroups)[i]->groupSize; j++) {
+            _ofsm_fsm_build_event_interest_mask(((_ofsmGroups)[i]->fsms)[j]);
         }
-        andedFsmFlags &= fsm->flags;
     }
-
-    *groupEarliestWakeupTime = earliestWakeupTime;
-    *groupAndedFsmFlags  = andedFsmFlags;
-}/*_ofsm_group_process_pending_event*/
-
-void _ofsm_setup() {
+#endif
 
 #ifdef OFSM_CONFIG_SUPPORT_INITIALIZATION_HANDLER
     //configure FSMs, call all initialization handlers
-#   ifndef OFSM_CONFIG_SIMULATION
-    uint8_t i, k;
+    OFSM_CONFIG_INDEX_TYPE k;
     OFSMGroup *group;
     OFSM *fsm;
-#   endif
     OFSMState fsmState;
     OFSMEventData e;
     fsmState.e = &e;
     for (i = 0; i < _ofsmGroupCount; i++) {
         group = (_ofsmGroups)[i];
         for (k = 0; k < group->groupSize; k++) {
-            fsm = (group->fsms)[k];
+            fsm = _OFSM_GROUP_FSM_LOAD(group, k);
             _ofsm_debug_printf(4, "F(%i)G(%i): Initializing...\n", k, i );
             fsmState.fsm = fsm;
             fsmState.timeLeftBeforeTimeout = 0;
@@ -233,13 +1730,36 @@ void _ofsm_setup() {
             if (fsm->initHandler) {
                 (fsm->initHandler)();
             }
+            _OFSM_GROUP_FSM_STORE(group, k);
+        }
+    }
+#endif
+
+#ifdef OFSM_CONFIG_WAKEUP_INDEX
+    /*initialization handlers may set transition delays, (re)build wakeup index afterwards*/
+    for (i = 0; i < _ofsmGroupCount; i++) {
+#   ifdef OFSM_CONFIG_FSM_POOL
+        if ((_ofsmGroups)[i]->pool) {
+            continue; /*pool groups are not indexed*/
         }
+#   endif
+        _ofsm_wakeup_index_rebuild((_ofsmGroups)[i]);
+    }
+#endif
+
+#ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+    /*all groups need to be visited at least once to calculate their wakeup summary*/
+    for (i = 0; i < _ofsmGroupCount; i++) {
+        _OFSM_PENDING_GROUP_SET(i);
     }
 #endif
 } /*_ofsm_setup*/
 
 void _ofsm_start() {
-    uint8_t i;
+    OFSM_CONFIG_INDEX_TYPE i;
+#if defined(OFSM_CONFIG_PENDING_GROUP_BITMAP) && !defined(OFSM_CONFIG_SIMULATION_WORK_STEALING)
+    OFSM_CONFIG_INDEX_TYPE k;
+#endif
     OFSMGroup *group;
     uint8_t andedFsmFlags;
     _OFSM_TIME_DATA_TYPE earliestWakeupTime;
@@ -271,25 +1791,77 @@ void _ofsm_start() {
 
 
         andedFsmFlags = (uint8_t)0xFFFF;
-        earliestWakeupTime = 0xFFFFFFFF;
+        earliestWakeupTime = (_OFSM_TIME_DATA_TYPE)-1;
+#ifdef _OFSM_GROUP_SUMMARY_CACHE
+#   if defined(OFSM_CONFIG_SIMULATION_WORK_STEALING)
+        /*groups are scheduled as their events get queued, visit all of them once to calculate initial wakeup summary*/
+        if (_ofsmFlags & _OFSM_FLAG_OFSM_FIRST_ITERATION) {
+            for (i = 0; i < _ofsmGroupCount; i++) {
+                _ofsm_simulation_worker_pool_add_group(i);
+            }
+        }
+#   elif defined(OFSM_CONFIG_PENDING_GROUP_BITMAP)
+        /*visit only groups marked as pending, others keep their cached wakeup summary*/
+        for (k = 0; k < ((_ofsmGroupCount + 7) >> 3); k++) {
+            if (!_ofsmPendingGroups[k]) {
+                continue;
+            }
+            for (i = (k << 3); i < (k << 3) + 8 && i < _ofsmGroupCount; i++) {
+                if (!_OFSM_PENDING_GROUP_IS_SET(i)) {
+                    continue;
+                }
+#       ifdef OFSM_CONFIG_SIMULATION_WORKER_THREADS
+                _ofsm_simulation_worker_pool_add_group(i);
+#       else
+                group = (_ofsmGroups)[i];
+                _ofsm_debug_printf(4,  "O: Processing event for group index %i...\n", i);
+                _ofsm_group_process_pending_event(group, i, &(group->earliestWakeupTime), &(group->andedFsmFlags));
+#       endif
+            }
+        }
+#   else
+        for (i = 0; i < _ofsmGroupCount; i++) {
+            _ofsm_simulation_worker_pool_add_group(i);
+        }
+#   endif /*OFSM_CONFIG_PENDING_GROUP_BITMAP*/
+#   ifdef OFSM_CONFIG_SIMULATION_WORKER_THREADS
+        _ofsm_simulation_worker_pool_run();
+#   endif
+
+        //if have pending events in either of group, repeat the step
+        if (_ofsmFlags & _OFSM_FLAG_OFSM_EVENT_QUEUED) {
+            _ofsm_debug_printf(4,  "O: At least one group has pending event(s). Re-process pending groups.\n");
+            continue;
+        }
+
+        /*all queues are drained, merge cached group summaries*/
+#   ifdef OFSM_CONFIG_SIMULATION_WORK_STEALING
+        _ofsm_simulation_worker_pool()->mutex.lock(); /*workers keep updating summaries of groups with newly queued events*/
+#   endif
+        for (i = 0; i < _ofsmGroupCount; i++) {
+            group = (_ofsmGroups)[i];
+            groupEarliestWakeupTime = group->earliestWakeupTime;
+            groupAndedFsmFlags = group->andedFsmFlags;
+#else
         for (i = 0; i < _ofsmGroupCount; i++) {
             group = (_ofsmGroups)[i];
             _ofsm_debug_printf(4,  "O: Processing event for group index %i...\n", i);
             _ofsm_group_process_pending_event(group, i, &groupEarliestWakeupTime, &groupAndedFsmFlags);
+#endif /*_OFSM_GROUP_SUMMARY_CACHE*/
 
-            if (!(groupAndedFsmFlags & _OFSM_FLAG_INFINITE_SLEEP)) {
-                if(_OFSM_TIME_A_GT_B(earliestWakeupTime, (andedFsmFlags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW), groupEarliestWakeupTime, (groupAndedFsmFlags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW))) {
-                    earliestWakeupTime = groupEarliestWakeupTime;
-                }
-            }
-            andedFsmFlags &= groupAndedFsmFlags;
+            _OFSM_WAKEUP_FOLD(earliestWakeupTime, andedFsmFlags, groupEarliestWakeupTime, groupAndedFsmFlags);
         }
+#ifdef OFSM_CONFIG_SIMULATION_WORK_STEALING
+        _ofsm_simulation_worker_pool()->mutex.unlock();
+#endif
 
+#ifndef _OFSM_GROUP_SUMMARY_CACHE
         //if have pending events in either of group, repeat the step
         if (_ofsmFlags & _OFSM_FLAG_OFSM_EVENT_QUEUED) {
             _ofsm_debug_printf(4,  "O: At least one group has pending event(s). Re-process all groups.\n");
             continue;
         }
+#endif
 
         if (!(andedFsmFlags & _OFSM_FLAG_INFINITE_SLEEP)) {
             ofsm_get_time(currentTime, timeFlags);
@@ -302,17 +1874,29 @@ void _ofsm_start() {
 
         OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
 			_ofsmWakeupTime = earliestWakeupTime;
-			_ofsmFlags = (_ofsmFlags & ~_OFSM_FLAG_ALL) | (andedFsmFlags & _OFSM_FLAG_ALL);
-			//if scheduled time is in overflow and timer is in overflow reset timer overflow flag
-			if ((_ofsmFlags & _OFSM_FLAG_INFINITE_SLEEP) || ((_ofsmFlags & _OFSM_FLAG_OFSM_TIMER_OVERFLOW) && (_ofsmFlags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW)))
+			/*two steps instead of single assignment: event queued and deep sleep flags may be updated by producers concurrently*/
+			_ofsmFlags &= ~(_OFSM_FLAG_ALL & ~andedFsmFlags);
+			_ofsmFlags |= (andedFsmFlags & _OFSM_FLAG_ALL);
+#ifndef OFSM_CONFIG_WIDE_TIME
+			//nothing is scheduled, start over from even epoch
+			if (_ofsmFlags & _OFSM_FLAG_INFINITE_SLEEP)
             {
                 _ofsmFlags &= ~(_OFSM_FLAG_OFSM_TIMER_OVERFLOW | _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW);
             }
+#endif
 			_ofsmFlags &= ~(_OFSM_FLAG_OFSM_FIRST_ITERATION | _OFSM_FLAG_OFSM_IN_PROCESS);
 		}
+#ifdef OFSM_CONFIG_SIMULATION_TICKLESS
+        _ofsm_simulation_tickless_deadline_published();
+#endif
 #ifndef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
         _ofsm_debug_printf(4,  "O: Entering sleep... Wakeup Time %ld.\n", _ofsmFlags & _OFSM_FLAG_INFINITE_SLEEP ? -1 : (long int)_ofsmWakeupTime);
+        _OFSM_TRACE(_OFSM_TRACE_SLEEP_ENTER, 0, 0, 0, (_ofsmFlags & _OFSM_FLAG_ALLOW_DEEP_SLEEP) > 0, (_ofsmFlags & _OFSM_FLAG_INFINITE_SLEEP ? _OFSM_TRACE_INFINITE : (uint32_t)_ofsmWakeupTime));
         OFSM_CONFIG_CUSTOM_ENTER_SLEEP_FUNC();
+#   ifdef OFSM_CONFIG_SIMULATION_TICKLESS
+        _ofsm_simulation_tickless_heartbeat(); /*time doesn't advance while no deadline is pending, catch up with real time before processing*/
+#   endif
+        _OFSM_TRACE(_OFSM_TRACE_SLEEP_EXIT, 0, 0, 0, 0, 0);
 
         _ofsm_debug_printf(4,  "O: Waked up.\n");
     } while (1);
@@ -326,12 +1910,35 @@ void _ofsm_start() {
 
 }/*_ofsm_start*/
 
-void _ofsm_queue_group_event(uint8_t groupIndex, OFSMGroup *group, bool forceNewEvent, uint8_t eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData) {
-    uint8_t copyNextEventIndex;
+void _ofsm_queue_group_event(OFSM_CONFIG_INDEX_TYPE groupIndex, OFSMGroup *group, bool forceNewEvent, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData) {
+    OFSM_CONFIG_INDEX_TYPE copyNextEventIndex;
     OFSMEventData *event;
 #ifdef OFSM_CONFIG_SIMULATION
     uint8_t debugFlags = 0x1; /*set buffer overflow*/
 #endif
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+    (void)copyNextEventIndex;
+    (void)event;
+    switch (_ofsm_simulation_lock_free_queue_push(group, forceNewEvent, eventCode, eventData)) {
+    case 1:
+        debugFlags = 0;
+        _OFSM_TRACE(_OFSM_TRACE_ENQUEUE, groupIndex, 0, eventCode, 0, (uint32_t)eventData);
+        /*set event queued flag (after event is claimed), so that _ofsm_start() knows if it need to continue processing*/
+        _ofsmFlags |= (_OFSM_FLAG_OFSM_EVENT_QUEUED);
+#   ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+        _OFSM_PENDING_GROUP_SET(groupIndex);
+#   endif
+        break;
+    case 2:
+        debugFlags = 0x2; /*set event replaced flag*/
+        _OFSM_TRACE(_OFSM_TRACE_ENQUEUE, groupIndex, 0, eventCode, _OFSM_TRACE_FLAG_REPLACED, (uint32_t)eventData);
+        break;
+    default:
+        _OFSM_TRACE(_OFSM_TRACE_DROP, groupIndex, 0, eventCode, 0, (uint32_t)eventData);
+        break;
+    }
+    _ofsmFlags &= ~(_OFSM_FLAG_OFSM_IN_DEEP_SLEEP);
+#else
     OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
         copyNextEventIndex = group->nextEventIndex;
 
@@ -352,10 +1959,7 @@ void _ofsm_queue_group_event(uint8_t groupIndex, OFSMGroup *group, bool forceNew
 
         /*update previous event if previous event codes matches*/
         if (!forceNewEvent) {
-            if (copyNextEventIndex == 0) {
-                copyNextEventIndex = group->eventQueueSize;
-            }
-            event = &(group->eventQueue[copyNextEventIndex - 1]);
+            event = &(group->eventQueue[(copyNextEventIndex == 0 ? group->eventQueueSize : copyNextEventIndex) - 1]);
             if (event->eventCode != eventCode) {
                 forceNewEvent = 1;
             }
@@ -366,11 +1970,13 @@ void _ofsm_queue_group_event(uint8_t groupIndex, OFSMGroup *group, bool forceNew
 #ifdef OFSM_CONFIG_SIMULATION
                 debugFlags |= 0x2; /*set event replaced flag*/
 #endif
+                _OFSM_TRACE(_OFSM_TRACE_ENQUEUE, groupIndex, 0, eventCode, _OFSM_TRACE_FLAG_REPLACED, (uint32_t)eventData);
             }
         }
 
         if (!(group->flags & _OFSM_FLAG_GROUP_BUFFER_OVERFLOW)) {
             if (forceNewEvent) {
+                _OFSM_TRACE(_OFSM_TRACE_ENQUEUE, groupIndex, 0, eventCode, 0, (uint32_t)eventData);
                 group->nextEventIndex++;
                 if (group->nextEventIndex >= group->eventQueueSize) {
                     group->nextEventIndex = 0;
@@ -385,6 +1991,9 @@ void _ofsm_queue_group_event(uint8_t groupIndex, OFSMGroup *group, bool forceNew
 
                 /*set event queued flag, so that _ofsm_start() knows if it need to continue processing*/
                 _ofsmFlags |= (_OFSM_FLAG_OFSM_EVENT_QUEUED);
+#ifdef OFSM_CONFIG_PENDING_GROUP_BITMAP
+                _OFSM_PENDING_GROUP_SET(groupIndex);
+#endif
 
                 /*event buffer overflow disable further events*/
                 if (group->nextEventIndex == group->currentEventIndex) {
@@ -392,7 +2001,15 @@ void _ofsm_queue_group_event(uint8_t groupIndex, OFSMGroup *group, bool forceNew
                 }
             }
         }
+        else if (forceNewEvent) {
+            _OFSM_TRACE(_OFSM_TRACE_DROP, groupIndex, 0, eventCode, 0, (uint32_t)eventData);
+        }
     }
+#endif /*OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE*/
+#ifdef OFSM_CONFIG_SIMULATION_WORK_STEALING
+    /*start processing right away; ofsm thread only merges wakeup summaries*/
+    _ofsm_simulation_worker_pool_schedule_group(groupIndex);
+#endif
 #ifdef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
 #   if OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE == 0
         OFSM_CONFIG_CUSTOM_WAKEUP_FUNC();
@@ -411,17 +2028,19 @@ void _ofsm_queue_group_event(uint8_t groupIndex, OFSMGroup *group, bool forceNew
     }
     else {
 #ifdef OFSM_CONFIG_SUPPORT_EVENT_DATA
-        _ofsm_debug_printf(3,  "G(%i): Queued eventCode %i eventData %i(0x%08X) (Updated %i, Set buffer overflow %i).\n", groupIndex, eventCode, eventData, eventData, (debugFlags & 0x2) > 0, (group->flags & _OFSM_FLAG_GROUP_BUFFER_OVERFLOW) > 0);
+        _ofsm_debug_printf(3,  "G(%i): Queued eventCode %i eventData %i(0x%08X) (Updated %i, Set buffer overflow %i).\n", groupIndex, eventCode, eventData, eventData, (debugFlags & 0x2) > 0, _OFSM_GROUP_IS_BUFFER_OVERFLOW(group) > 0);
 #else
-        _ofsm_debug_printf(3,  "G(%i): Queued eventCode %i (Updated %i, Set buffer overflow %i).\n", groupIndex, eventCode, (debugFlags & 0x2) > 0, (group->flags & _OFSM_FLAG_GROUP_BUFFER_OVERFLOW) > 0);
+        _ofsm_debug_printf(3,  "G(%i): Queued eventCode %i (Updated %i, Set buffer overflow %i).\n", groupIndex, eventCode, (debugFlags & 0x2) > 0, _OFSM_GROUP_IS_BUFFER_OVERFLOW(group) > 0);
 #endif
 
+#ifndef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
         _ofsm_debug_printf(4,  "G(%i): currentEventIndex %i, nextEventIndex %i.\n", groupIndex, group->currentEventIndex, group->nextEventIndex);
+#endif
     }
 #endif
 }/*_ofsm_queue_group_event*/
 
-void ofsm_queue_group_event(uint8_t groupIndex, bool forceNewEvent, uint8_t eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData)
+void ofsm_queue_group_event(OFSM_CONFIG_INDEX_TYPE groupIndex, bool forceNewEvent, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData)
 {
 #ifdef OFSM_CONFIG_SIMULATION
     if (groupIndex >= _ofsmGroupCount) {
@@ -436,8 +2055,8 @@ void ofsm_queue_group_event(uint8_t groupIndex, bool forceNewEvent, uint8_t even
     _ofsm_queue_group_event(groupIndex, _ofsmGroups[groupIndex], forceNewEvent, eventCode, eventData);
 }/*ofsm_queue_group_event*/
 
-void ofsm_queue_global_event(bool forceNewEvent, uint8_t eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData) {
-    uint8_t i;
+void ofsm_queue_global_event(bool forceNewEvent, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_EVENT_DATA_TYPE eventData) {
+    OFSM_CONFIG_INDEX_TYPE i;
     OFSMGroup *group;
 
     for (i = 0; i < _ofsmGroupCount; i++) {
@@ -455,6 +2074,7 @@ static inline void _ofsm_check_timeout()
         return;
     }
     if (_OFSM_TIME_A_GTE_B(_ofsmTime, (_ofsmFlags & _OFSM_FLAG_OFSM_TIMER_OVERFLOW), _ofsmWakeupTime, (_ofsmFlags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW))) {
+        _OFSM_TRACE(_OFSM_TRACE_HEARTBEAT, 0, 0, 0, 0, (uint32_t)_ofsmWakeupTime);
         ofsm_queue_global_event(false, 0, 0); /*this call will wakeup main loop*/
 
 #if OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE == 1 /*in this mode ofsm_queue_... will not wakeup*/
@@ -465,17 +2085,36 @@ static inline void _ofsm_check_timeout()
 
 static inline void ofsm_heartbeat(_OFSM_TIME_DATA_TYPE currentTime)
 {
+#ifdef OFSM_CONFIG_WIDE_TIME
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        _ofsmTime = currentTime;
+        _ofsm_check_timeout();
+    }
+#else
     _OFSM_TIME_DATA_TYPE prevTime;
     OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
 		prevTime = _ofsmTime;
         _ofsmTime = currentTime;
         if (_ofsmTime < prevTime) {
-            _ofsmFlags |= _OFSM_FLAG_OFSM_TIMER_OVERFLOW;
+            _ofsmFlags ^= _OFSM_FLAG_OFSM_TIMER_OVERFLOW;
         }
         _ofsm_check_timeout();
     }
+#endif
 }/*ofsm_heartbeat*/
 
+#ifdef OFSM_CONFIG_WIDE_TIME
+/*heartbeat for providers with wrapping 32 bit tick counter (e.g. micros()/millis()): extends it to 64 bit time.
+All heartbeats should go through this function and come at least once per 2^32 ticks*/
+static inline void ofsm_heartbeat_32(uint32_t currentTime)
+{
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        _ofsmTime += (uint32_t)(currentTime - (uint32_t)_ofsmTime);
+        _ofsm_check_timeout();
+    }
+}/*ofsm_heartbeat_32*/
+#endif /*OFSM_CONFIG_WIDE_TIME*/
+
 /*--------------------------------------
 SIMULATION specific code
 ----------------------------------------*/
@@ -483,8 +2122,8 @@ SIMULATION specific code
 #ifdef OFSM_CONFIG_SIMULATION
 
 struct OFSMSimulationStatusReport {
-    uint8_t grpIndex;
-    uint8_t fsmIndex;
+    OFSM_CONFIG_INDEX_TYPE grpIndex;
+    OFSM_CONFIG_INDEX_TYPE fsmIndex;
     _OFSM_TIME_DATA_TYPE ofsmTime;
     //OFSM status
     bool ofsmInfiniteSleep;
@@ -494,29 +2133,55 @@ struct OFSMSimulationStatusReport {
     _OFSM_TIME_DATA_TYPE ofsmScheduledWakeupTime;
     //Group status
     bool grpEventBufferOverflow;
-    uint8_t grpPendingEventCount;
+    OFSM_CONFIG_INDEX_TYPE grpPendingEventCount;
     //FSM status
     bool fsmInfiniteSleep;
     bool fsmTransitionPrevented;
     bool fsmTransitionStateOverriden;
     bool fsmScheduledTimeOverflow;
     _OFSM_TIME_DATA_TYPE fsmScheduledWakeupTime;
-    uint8_t fsmCurrentState;
+    OFSM_CONFIG_INDEX_TYPE fsmCurrentState;
 };
 
+#ifdef OFSM_CONFIG_MULTI_INSTANCE
+#   define _OFSM_SIMULATION_SLEEP_MUTEX (_ofsmContext->sleepMutex)
+#   define _OFSM_SIMULATION_SLEEP_CONDITION (_ofsmContext->sleepCondition)
+#   define _OFSM_SIMULATION_SLEEPING (_ofsmContext->sleeping)
+#else
 std::mutex cvm;
 std::condition_variable cv;
+#   if defined(OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE) || defined(OFSM_CONFIG_SIMULATION_WORK_STEALING)
+std::atomic<bool> _ofsm_simulation_sleeping; /*producers notify cv only when ofsm is (about to be) waiting on it*/
+#   endif
+#   define _OFSM_SIMULATION_SLEEP_MUTEX cvm
+#   define _OFSM_SIMULATION_SLEEP_CONDITION cv
+#   define _OFSM_SIMULATION_SLEEPING _ofsm_simulation_sleeping
+#endif
+
+static inline bool _ofsm_is_not_space(char c) {
+    return !isspace((unsigned char)c);
+}
 
 static inline std::string &ltrim(std::string &s) {
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(), std::not1(std::ptr_fun<int, int>(std::isspace))));
+    s.erase(s.begin(), std::find_if(s.begin(), s.end(), _ofsm_is_not_space));
     return s;
 }
 
 static inline std::string &rtrim(std::string &s) {
-    s.erase(std::find_if(s.rbegin(), s.rend(), std::not1(std::ptr_fun<int, int>(std::isspace))).base(), s.end());
+    s.erase(std::find_if(s.rbegin(), s.rend(), _ofsm_is_not_space).base(), s.end());
     return s;
 }
 
+/*trims [*begin, *end) range in place, no copy*/
+static inline void _ofsm_trim_range(const char **begin, const char **end) {
+    while (*begin < *end && isspace((unsigned char)**begin)) {
+        (*begin)++;
+    }
+    while (*end > *begin && isspace((unsigned char)(*end)[-1])) {
+        (*end)--;
+    }
+}
+
 static inline std::string &trim(std::string &s) {
     return ltrim(rtrim(s));
 }
@@ -528,7 +2193,7 @@ static inline std::string &toLower(std::string &s) {
 
 #ifdef _OFSM_IMPL_SIMULATION_STATUS_REPORT_PRINTER
 void _ofsm_simulation_status_report_printer(OFSMSimulationStatusReport *r) {
-    char buf[80];
+    char buf[128]; /*64 bit times take 20 digits*/
     _ofsm_snprintf(buf, (sizeof(buf) / sizeof(*buf)), "-O[%c%c]-G(%i)[%c,%03d]-F(%i)[%c%c%c]-S(%i)-TW[%010lu%c,O:%010lu%c,F:%010lu%c]"
         //OFSM (-O)
         , (r->ofsmInfiniteSleep ? 'I' : 'i')
@@ -557,7 +2222,7 @@ void _ofsm_simulation_status_report_printer(OFSMSimulationStatusReport *r) {
 }
 #endif
 
-void _ofsm_simulation_create_status_report(OFSMSimulationStatusReport *r, uint8_t groupIndex, uint8_t fsmIndex) {
+void _ofsm_simulation_create_status_report(OFSMSimulationStatusReport *r, OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex) {
     OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
         r->grpIndex = groupIndex;
         r->fsmIndex = fsmIndex;
@@ -574,6 +2239,10 @@ void _ofsm_simulation_create_status_report(OFSMSimulationStatusReport *r, uint8_
         }
         //Group
         OFSMGroup *grp = (_ofsmGroups[groupIndex]);
+#ifdef OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE
+        r->grpPendingEventCount = _ofsm_simulation_lock_free_queue_pending_count(grp);
+        r->grpEventBufferOverflow = (r->grpPendingEventCount >= grp->eventQueueSize);
+#else
         r->grpEventBufferOverflow = (bool)((grp->flags & _OFSM_FLAG_GROUP_BUFFER_OVERFLOW) > 0);
         if (r->grpEventBufferOverflow) {
             if (grp->currentEventIndex == grp->nextEventIndex) {
@@ -591,14 +2260,15 @@ void _ofsm_simulation_create_status_report(OFSMSimulationStatusReport *r, uint8_
                 r->grpPendingEventCount = grp->nextEventIndex - grp->currentEventIndex;
             }
         }
+#endif
         //FSM
-        OFSM *fsm = (grp->fsms)[fsmIndex];
-        r->fsmInfiniteSleep = (bool)((fsm->flags & _OFSM_FLAG_INFINITE_SLEEP) > 0);
-        r->fsmTransitionPrevented = (bool)((fsm->flags & _OFSM_FLAG_FSM_PREVENT_TRANSITION) > 0);
-        r->fsmTransitionStateOverriden = (bool)((fsm->flags & _OFSM_FLAG_FSM_NEXT_STATE_OVERRIDE) > 0);
-        r->fsmScheduledTimeOverflow = (bool)((fsm->flags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW) > 0);
-        r->fsmScheduledWakeupTime = fsm->wakeupTime;
-        r->fsmCurrentState = fsm->currentState;
+        uint8_t fsmFlags = _OFSM_GROUP_FSM_FIELD(grp, fsmIndex, flags);
+        r->fsmInfiniteSleep = (bool)((fsmFlags & _OFSM_FLAG_INFINITE_SLEEP) > 0);
+        r->fsmTransitionPrevented = (bool)((fsmFlags & _OFSM_FLAG_FSM_PREVENT_TRANSITION) > 0);
+        r->fsmTransitionStateOverriden = (bool)((fsmFlags & _OFSM_FLAG_FSM_NEXT_STATE_OVERRIDE) > 0);
+        r->fsmScheduledTimeOverflow = (bool)((fsmFlags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW) > 0);
+        r->fsmScheduledWakeupTime = _OFSM_GROUP_FSM_FIELD(grp, fsmIndex, wakeupTime);
+        r->fsmCurrentState = _OFSM_GROUP_FSM_FIELD(grp, fsmIndex, currentState);
         if (r->fsmInfiniteSleep) {
             r->fsmScheduledWakeupTime = 0;
             r->fsmScheduledTimeOverflow = 0;
@@ -606,12 +2276,104 @@ void _ofsm_simulation_create_status_report(OFSMSimulationStatusReport *r, uint8_
     }
 }
 
+#ifdef _OFSM_IMPL_SIMULATION_PROFILING_CLOCK
+static inline uint32_t _ofsm_simulation_profiling_clock() {
+#   if defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc(); /*cpu cycles*/
+#   else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#   endif
+}
+#endif /* _OFSM_IMPL_SIMULATION_PROFILING_CLOCK */
+
+#ifdef OFSM_CONFIG_PROFILING
+/*prints profiles of group (all groups if groupIndex < 0) and fsm (all fsms of the group if fsmIndex < 0) ordered by group, fsm, state and event,
+followed by summary line, which becomes assert compare string (durations are not reproducible, counts are)*/
+void _ofsm_simulation_profile_printer(int groupIndex, int fsmIndex) {
+    OFSMProfile profiles[OFSM_CONFIG_PROFILING_SLOT_COUNT];
+    uint32_t droppedCount;
+    unsigned long i, n = 0;
+    uint32_t count = 0, transitionCount = 0;
+    int b, lastBucket;
+    char buf[80];
+
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        for (i = 0; i < OFSM_CONFIG_PROFILING_SLOT_COUNT; i++) {
+            if (_ofsmProfiles[i].count && (groupIndex < 0 || _ofsmProfiles[i].groupIndex == groupIndex) && (fsmIndex < 0 || _ofsmProfiles[i].fsmIndex == fsmIndex)) {
+                profiles[n++] = _ofsmProfiles[i];
+            }
+        }
+        droppedCount = _ofsmProfileDroppedCount;
+    }
+    std::sort(profiles, profiles + n, [](const OFSMProfile &a, const OFSMProfile &b) {
+        if (a.groupIndex != b.groupIndex) return a.groupIndex < b.groupIndex;
+        if (a.fsmIndex != b.fsmIndex) return a.fsmIndex < b.fsmIndex;
+        if (a.state != b.state) return a.state < b.state;
+        return a.eventCode < b.eventCode;
+    });
+    for (i = 0; i < n; i++) {
+        std::cout << "-P-G(" << (unsigned long)profiles[i].groupIndex << ")-F(" << (unsigned long)profiles[i].fsmIndex
+            << ")-S(" << (unsigned long)profiles[i].state << ")-E(" << (unsigned long)profiles[i].eventCode
+            << ")-C(" << profiles[i].count << ")-T(" << profiles[i].transitionCount << ")-MAX(" << profiles[i].maxDuration << ")-H(";
+        for (lastBucket = OFSM_CONFIG_PROFILING_BUCKET_COUNT - 1; lastBucket > 0 && !(profiles[i].histogram)[lastBucket]; lastBucket--);
+        for (b = 0; b <= lastBucket; b++) {
+            std::cout << (b ? "," : "") << (profiles[i].histogram)[b];
+        }
+        std::cout << ")" << std::endl;
+        count += profiles[i].count;
+        transitionCount += profiles[i].transitionCount;
+    }
+    _ofsm_snprintf(buf, (sizeof(buf) / sizeof(*buf)), "-M-P(%lu)-C(%lu)-T(%lu)-D(%lu)", n, (unsigned long)count, (unsigned long)transitionCount, (unsigned long)droppedCount);
+    ofsm_simulation_set_assert_compare_string(buf);
+    std::cout << buf << std::endl;
+}/*_ofsm_simulation_profile_printer*/
+#endif /*OFSM_CONFIG_PROFILING*/
+
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+static std::ofstream _ofsmSimulationTraceStream;
+
+static void _ofsm_simulation_trace_writer(const uint8_t *data, uint16_t size) {
+    _ofsmSimulationTraceStream.write((const char*)data, size);
+}/*_ofsm_simulation_trace_writer*/
+
+/*dumps trace into binary file (see ofsm_trace_dump()), prints summary line, which becomes assert compare string*/
+void _ofsm_simulation_trace_file_dump(const char *fileName) {
+    uint32_t total;
+    char buf[80];
+
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        total = _ofsmTraceCount;
+    }
+    if (strcmp(fileName, "-")) { /*'-' - counts only, nothing is written*/
+        _ofsmSimulationTraceStream.open(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!_ofsmSimulationTraceStream.is_open()) {
+            _ofsm_debug_printf(1, "Cannot open trace file '%s'.\n", fileName);
+            return;
+        }
+        ofsm_trace_dump(_ofsm_simulation_trace_writer);
+        _ofsmSimulationTraceStream.close();
+    }
+    _ofsm_snprintf(buf, (sizeof(buf) / sizeof(*buf)), "-T-R(%lu)-N(%lu)", (unsigned long)(total < OFSM_CONFIG_TRACE_BUFFER_SIZE ? total : OFSM_CONFIG_TRACE_BUFFER_SIZE), (unsigned long)total);
+    ofsm_simulation_set_assert_compare_string(buf);
+    std::cout << buf << std::endl;
+}/*_ofsm_simulation_trace_file_dump*/
+#endif /*OFSM_CONFIG_TRACE_BUFFER_SIZE*/
+
 #ifdef _OFSM_IMPL_SIMULATION_ENTER_SLEEP
 void _ofsm_simulation_enter_sleep() {
         _ofsmFlags &= ~_OFSM_FLAG_OFSM_IN_PROCESS; /*enable wakeup on timeout*/
-        std::unique_lock<std::mutex> lk(cvm);
+        std::unique_lock<std::mutex> lk(_OFSM_SIMULATION_SLEEP_MUTEX);
 
-        cv.wait(lk);
+#if defined(OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE) || defined(OFSM_CONFIG_SIMULATION_WORK_STEALING)
+        /*announce sleep before checking event queued flag: either producer sees the announcement or ofsm sees the flag*/
+        _OFSM_SIMULATION_SLEEPING = true;
+#endif
+        /*producers set event queued flag before they notify under sleep mutex, so that event queued after the last check of the flag
+        by ofsm loop doesn't get lost (nothing else would wake up instance that sleeps infinitely)*/
+        _OFSM_SIMULATION_SLEEP_CONDITION.wait(lk, []() { return (_ofsmFlags & _OFSM_FLAG_OFSM_EVENT_QUEUED) != 0; });
+#if defined(OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE) || defined(OFSM_CONFIG_SIMULATION_WORK_STEALING)
+        _OFSM_SIMULATION_SLEEPING = false;
+#endif
         _ofsmFlags &= ~(_OFSM_FLAG_OFSM_EVENT_QUEUED | _OFSM_FLAG_INFINITE_SLEEP);
         lk.unlock();
 }
@@ -620,8 +2382,13 @@ void _ofsm_simulation_enter_sleep() {
 #ifdef _OFSM_IMPL_SIMULATION_WAKEUP
 void _ofsm_simulation_wakeup() {
 #   ifndef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
-    std::unique_lock<std::mutex> lk(cvm);
-    cv.notify_one();
+#       if defined(OFSM_CONFIG_SIMULATION_LOCK_FREE_QUEUE) || defined(OFSM_CONFIG_SIMULATION_WORK_STEALING)
+    if (!_OFSM_SIMULATION_SLEEPING) {
+        return; /*ofsm is running and will see event queued flag*/
+    }
+#       endif
+    std::unique_lock<std::mutex> lk(_OFSM_SIMULATION_SLEEP_MUTEX);
+    _OFSM_SIMULATION_SLEEP_CONDITION.notify_one();
     lk.unlock();
 #   else
     //in script mode call _ofsm_start() directly; it will return
@@ -631,12 +2398,14 @@ void _ofsm_simulation_wakeup() {
 #endif /* _OFSM_IMPL_SIMULATION_WAKEUP */
 
 int _ofsm_simulation_check_for_assert(std::string &assertCompareString, int lineNumber) {
-    std::string lastOut = (char*)_ofsm_simulation_assert_compare_string;
-    trim(lastOut);
-    if (assertCompareString != lastOut) {
+    const char *lastOut = (const char*)_ofsm_simulation_assert_compare_string;
+    const char *lastOutEnd = lastOut + strlen(lastOut);
+    _ofsm_trim_range(&lastOut, &lastOutEnd);
+    if (assertCompareString.compare(0, std::string::npos, lastOut, lastOutEnd - lastOut)) {
         std::cout << "ASSERT at line: " << lineNumber << std::endl;
         std::cout << "\tExpected: " << assertCompareString << std::endl;
-        std::cout << "\tProduced: " << lastOut << std::endl;
+        std::cout << "\tProduced: ";
+        std::cout.write(lastOut, lastOutEnd - lastOut) << std::endl;
         return 1;
     }
     return 0;
@@ -651,274 +2420,1019 @@ void _ofsm_simulation_fsm_thread(int ignore) {
 #ifndef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
     _ofsm_debug_printf(1, "Exiting Loop thread...\n");
 #endif
-}/*_ofsm_simulation_fsm_thread*/
+}/*_ofsm_simulation_fsm_thread*/
+
+#ifdef OFSM_CONFIG_SNAPSHOT
+static bool _ofsmSimulationHeartbeatRebase; /*time was moved back by restore of checkpoint*/
+#endif
+
+void _ofsm_simulation_heartbeat_provider_thread(int tickSize) {
+    _OFSM_TIME_DATA_TYPE currentTime = 0;
+    bool doReturn = false;
+    while (1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(tickSize));
+
+        OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+            _OFSM_TIME_DATA_TYPE time;
+            ofsm_get_time(time, time);
+            if (time > currentTime) {
+                currentTime = time;
+            }
+#ifdef OFSM_CONFIG_SNAPSHOT
+            if (_ofsmSimulationHeartbeatRebase) {
+                _ofsmSimulationHeartbeatRebase = false;
+                currentTime = time;
+            }
+#endif
+            if (_ofsmFlags & _OFSM_FLAG_OFSM_SIMULATION_EXIT) {
+                doReturn = true; /*don't return here, as simulation ATOMIC_BLOCK mutex will remain blocked*/
+            }
+        }
+        if (doReturn) {
+#ifndef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
+            _ofsm_debug_printf(1, "Exiting Heartbeat provider thread...\n");
+#endif
+            return;
+        }
+        currentTime++;
+        ofsm_heartbeat(currentTime);
+    }
+}/*_ofsm_simulation_heartbeat_provider_thread*/
+
+#ifdef OFSM_CONFIG_SIMULATION_VIRTUAL_TIME
+/*process everything that is queued, regardless of script mode wakeup type*/
+static void _ofsm_simulation_virtual_time_drain() {
+    while (_ofsmFlags & _OFSM_FLAG_OFSM_EVENT_QUEUED) {
+        _ofsm_start();
+    }
+}
+
+/*discrete event simulation: jump time from one scheduled wakeup time to the next one until target time is reached, draining all events at each of them*/
+void _ofsm_simulation_virtual_time_advance(_OFSM_TIME_DATA_TYPE targetTime) {
+    _OFSM_TIME_DATA_TYPE nextTime;
+    _ofsm_simulation_virtual_time_drain();
+    do {
+        nextTime = targetTime;
+        OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+            /*wakeup time past time overflow is never before target time*/
+            if (!(_ofsmFlags & _OFSM_FLAG_INFINITE_SLEEP) && !(_ofsmFlags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW) == !(_ofsmFlags & _OFSM_FLAG_OFSM_TIMER_OVERFLOW)
+                && _ofsmWakeupTime > _ofsmTime && _ofsmWakeupTime < targetTime) {
+                nextTime = _ofsmWakeupTime;
+            }
+        }
+        _ofsm_debug_printf(4, "V: Advancing time to %lu.\n", (long unsigned int)nextTime);
+        ofsm_heartbeat(nextTime);
+        _ofsm_simulation_virtual_time_drain();
+    } while (nextTime != targetTime);
+}/*_ofsm_simulation_virtual_time_advance*/
+#endif /*OFSM_CONFIG_SIMULATION_VIRTUAL_TIME*/
+
+#ifdef OFSM_CONFIG_SIMULATION_TICKLESS
+/*tickless heartbeat provider: OFSM time is computed from elapsed real time; provider thread sleeps until published wakeup time (or forever while in infinite sleep)*/
+std::chrono::steady_clock::time_point _ofsm_simulation_tickless_epoch;
+uint64_t _ofsm_simulation_tickless_offset; /*ticks added to elapsed real time, so that time moved forward by h[eartbeat] command is kept*/
+uint64_t _ofsm_simulation_tickless_last; /*last returned time, not truncated to OFSM time width*/
+std::mutex _ofsm_simulation_tickless_mutex;
+std::condition_variable _ofsm_simulation_tickless_cv;
+bool _ofsm_simulation_tickless_deadline_changed;
+
+void _ofsm_simulation_tickless_reset() {
+    _ofsm_simulation_tickless_epoch = std::chrono::steady_clock::now();
+    _ofsm_simulation_tickless_offset = 0;
+    _ofsm_simulation_tickless_last = 0;
+}
+
+/*time goes on from current OFSM time, even if it is behind already returned time (e.g. restored checkpoint); must be called from within atomic block*/
+void _ofsm_simulation_tickless_rebase() {
+    _ofsm_simulation_tickless_epoch = std::chrono::steady_clock::now();
+    _ofsm_simulation_tickless_offset = _ofsmTime;
+    _ofsm_simulation_tickless_last = _ofsmTime;
+}
+
+/*current time in ticks, must be called from within atomic block.
+Ticks are counted in 64 bit, returned time wraps the same way tick heartbeat provider counter does: ofsm_heartbeat() raises timer overflow for it*/
+_OFSM_TIME_DATA_TYPE _ofsm_simulation_tickless_time() {
+    uint64_t ticks = (uint64_t)(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _ofsm_simulation_tickless_epoch).count() / OFSM_CONFIG_SIMULATION_TICK_MS);
+    ticks += _ofsm_simulation_tickless_offset;
+    /*OFSM time moved forward since last call by other means (h[eartbeat] command); distance is taken modulo OFSM time width, so that wrap of time is not taken for time going backwards*/
+    _ofsm_simulation_tickless_last += (_OFSM_TIME_DATA_TYPE)(_ofsmTime - (_OFSM_TIME_DATA_TYPE)_ofsm_simulation_tickless_last);
+    if (ticks < _ofsm_simulation_tickless_last) {
+        _ofsm_simulation_tickless_offset += _ofsm_simulation_tickless_last - ticks;
+        ticks = _ofsm_simulation_tickless_last;
+    }
+    _ofsm_simulation_tickless_last = ticks;
+    return (_OFSM_TIME_DATA_TYPE)ticks;
+}
+
+void _ofsm_simulation_tickless_heartbeat() {
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        ofsm_heartbeat(_ofsm_simulation_tickless_time());
+    }
+}
+
+/*called (outside of atomic block) when ofsm publishes new wakeup time or exits*/
+void _ofsm_simulation_tickless_deadline_published() {
+    std::lock_guard<std::mutex> lk(_ofsm_simulation_tickless_mutex);
+    _ofsm_simulation_tickless_deadline_changed = true;
+    _ofsm_simulation_tickless_cv.notify_one();
+}
+
+void _ofsm_simulation_tickless_heartbeat_provider_thread(int tickSize) {
+    std::chrono::steady_clock::time_point deadline;
+    bool waitForDeadline = false;
+    bool doReturn = false;
+    while (1) {
+        {
+            std::lock_guard<std::mutex> lk(_ofsm_simulation_tickless_mutex);
+            _ofsm_simulation_tickless_deadline_changed = false;
+        }
+        OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+            ofsm_heartbeat(_ofsm_simulation_tickless_time());
+            /*while in process, wakeup time is not yet known: it will be published once processing is complete;
+            reached wakeup time has just queued timeout event, new wakeup time will be published too*/
+            waitForDeadline = !(_ofsmFlags & (_OFSM_FLAG_INFINITE_SLEEP | _OFSM_FLAG_OFSM_IN_PROCESS))
+                && !_OFSM_TIME_A_GTE_B(_ofsmTime, (_ofsmFlags & _OFSM_FLAG_OFSM_TIMER_OVERFLOW), _ofsmWakeupTime, (_ofsmFlags & _OFSM_FLAG_SCHEDULED_TIME_OVERFLOW));
+            /*wakeup time past time overflow is still ahead: distance is taken modulo OFSM time width*/
+            deadline = _ofsm_simulation_tickless_epoch + std::chrono::milliseconds((_ofsm_simulation_tickless_last + (_OFSM_TIME_DATA_TYPE)(_ofsmWakeupTime - _ofsmTime) - _ofsm_simulation_tickless_offset) * tickSize);
+            if (_ofsmFlags & _OFSM_FLAG_OFSM_SIMULATION_EXIT) {
+                doReturn = true; /*don't return here, as simulation ATOMIC_BLOCK mutex will remain blocked*/
+            }
+        }
+        if (doReturn) {
+            _ofsm_debug_printf(1, "Exiting Heartbeat provider thread...\n");
+            return;
+        }
+        std::unique_lock<std::mutex> lk(_ofsm_simulation_tickless_mutex);
+        if (waitForDeadline) {
+            _ofsm_simulation_tickless_cv.wait_until(lk, deadline, []() { return _ofsm_simulation_tickless_deadline_changed; });
+        }
+        else {
+            _ofsm_simulation_tickless_cv.wait(lk, []() { return _ofsm_simulation_tickless_deadline_changed; });
+        }
+    }
+}/*_ofsm_simulation_tickless_heartbeat_provider_thread*/
+#endif /*OFSM_CONFIG_SIMULATION_TICKLESS*/
+
+void _ofsm_simulation_sleep_thread(int sleepMilliseconds) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(sleepMilliseconds));
+}/*_ofsm_simulation_sleep_thread*/
+
+void _ofsm_simulation_sleep(int sleepMilliseconds) {
+    std::thread sleepThread(_ofsm_simulation_sleep_thread, sleepMilliseconds);
+    sleepThread.join();
+}/*_ofsm_simulation_sleep*/
+
+#ifdef _OFSM_IMPL_EVENT_GENERATOR
+
+int lineNumber = 0;
+std::ifstream fileStream;
+
+/*max number of comma separated tokens of a command; the rest of the line is reported and ignored*/
+#define _OFSM_SIMULATION_MAX_TOKEN_COUNT 16
+
+/*------------------------------------------------
+Binary script: 8 bytes header ("OFSB", version 1, 3 reserved bytes) followed by operations.
+Operation: opcode byte, line number delta (script line the operation was compiled from), operands.
+Integers are LEB128 varints, strings are varint length followed by bytes.
+-------------------------------------------------*/
+#define _OFSM_SCRIPT_VERSION            1
+#define _OFSM_SCRIPT_OP_QUEUE           1   /*mods, eventCode, eventData, groupIndex*/
+#define _OFSM_SCRIPT_OP_HEARTBEAT       2   /*(next tick)*/
+#define _OFSM_SCRIPT_OP_HEARTBEAT_AT    3   /*time*/
+#define _OFSM_SCRIPT_OP_DELAY           4   /*milliseconds*/
+#define _OFSM_SCRIPT_OP_WAKEUP          5
+#define _OFSM_SCRIPT_OP_STATUS          6   /*groupIndex, fsmIndex*/
+#define _OFSM_SCRIPT_OP_PRINT           7   /*string*/
+#define _OFSM_SCRIPT_OP_ASSERT          8   /*assert compare string of preceding operation*/
+#define _OFSM_SCRIPT_OP_RESET           9
+#define _OFSM_SCRIPT_OP_EXIT            10
+#define _OFSM_SCRIPT_OP_TEXT            11  /*line that is processed as text: custom (hook) or unrecognized command*/
+#define _OFSM_SCRIPT_OP_METRICS         12  /*reset, groupIndex + 1, fsmIndex + 1 (0 - all)*/
+#define _OFSM_SCRIPT_OP_TRACE           13  /*reset, file name*/
+#define _OFSM_SCRIPT_OP_CHECKPOINT      14  /*restore*/
+
+#define _OFSM_SCRIPT_QUEUE_GLOBAL       0x1
+#define _OFSM_SCRIPT_QUEUE_FORCE        0x2
+#define _OFSM_SCRIPT_QUEUE_GROUP        0x4 /*group index is specified (gets validated)*/
+
+static std::ofstream *_ofsmSimulationCompileStream; /*while script is being compiled (-c), commands are encoded instead of executed*/
+static int _ofsmSimulationCompiledLineNumber;
+
+static void _ofsm_simulation_script_put_varint(uint64_t value) {
+    char buf[10];
+    int n = 0;
+    do {
+        buf[n] = (char)(value & 0x7F);
+        value >>= 7;
+        if (value) {
+            buf[n] |= 0x80;
+        }
+        n++;
+    } while (value);
+    _ofsmSimulationCompileStream->write(buf, n);
+}/*_ofsm_simulation_script_put_varint*/
+
+static void _ofsm_simulation_script_put_string(const char *s, size_t length) {
+    _ofsm_simulation_script_put_varint(length);
+    _ofsmSimulationCompileStream->write(s, length);
+}/*_ofsm_simulation_script_put_string*/
+
+static void _ofsm_simulation_script_put_op(uint8_t op) {
+    _ofsmSimulationCompileStream->put((char)op);
+    _ofsm_simulation_script_put_varint((uint64_t)(lineNumber - _ofsmSimulationCompiledLineNumber));
+    _ofsmSimulationCompiledLineNumber = lineNumber;
+}/*_ofsm_simulation_script_put_op*/
+
+/*------------------------------------------------
+Commands shared by text script and binary script: while compiling they are encoded, otherwise executed.
+Return 1 if assert compare string (if any) should be checked after the command, 0 otherwise.
+-------------------------------------------------*/
+static int _ofsm_simulation_command_queue(uint8_t mods, OFSM_CONFIG_INDEX_TYPE eventCode, uint8_t eventData, OFSM_CONFIG_INDEX_TYPE groupIndex) {
+    if (_ofsmSimulationCompileStream) {
+        _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_QUEUE);
+        _ofsm_simulation_script_put_varint(mods);
+        _ofsm_simulation_script_put_varint(eventCode);
+        _ofsm_simulation_script_put_varint(eventData);
+        _ofsm_simulation_script_put_varint(groupIndex);
+        return 1;
+    }
+    if ((mods & _OFSM_SCRIPT_QUEUE_GROUP) && groupIndex >= _ofsmGroupCount) {
+        printf("ASSERT at line: %i: Invalid Group Index %i.\n", lineNumber, groupIndex);
+        return 0;
+    }
+    if (mods & _OFSM_SCRIPT_QUEUE_GLOBAL) {
+        ofsm_queue_global_event((mods & _OFSM_SCRIPT_QUEUE_FORCE) > 0, eventCode, eventData);
+    }
+    else {
+        ofsm_queue_group_event(groupIndex, (mods & _OFSM_SCRIPT_QUEUE_FORCE) > 0, eventCode, eventData);
+    }
+    return 1;
+}/*_ofsm_simulation_command_queue*/
+
+static int _ofsm_simulation_command_heartbeat(bool isTimeSpecified, _OFSM_TIME_DATA_TYPE currentTime) {
+    if (_ofsmSimulationCompileStream) {
+        _ofsm_simulation_script_put_op(isTimeSpecified ? _OFSM_SCRIPT_OP_HEARTBEAT_AT : _OFSM_SCRIPT_OP_HEARTBEAT);
+        if (isTimeSpecified) {
+            _ofsm_simulation_script_put_varint(currentTime);
+        }
+        return 1;
+    }
+    if (!isTimeSpecified) {
+        OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+            currentTime = _ofsmTime + 1;
+        }
+    }
+#ifdef OFSM_CONFIG_SIMULATION_VIRTUAL_TIME
+    _ofsm_simulation_virtual_time_advance(currentTime);
+#else
+    ofsm_heartbeat(currentTime);
+#endif
+    return 1;
+}/*_ofsm_simulation_command_heartbeat*/
+
+static int _ofsm_simulation_command_delay(_OFSM_TIME_DATA_TYPE sleepPeriod) {
+    if (_ofsmSimulationCompileStream) {
+        _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_DELAY);
+        _ofsm_simulation_script_put_varint(sleepPeriod);
+        return 1;
+    }
+#ifdef OFSM_CONFIG_SIMULATION_VIRTUAL_TIME
+    /*no wall clock sleep: the same amount of time passes in virtual time*/
+    OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
+        sleepPeriod = _ofsmTime + sleepPeriod / OFSM_CONFIG_SIMULATION_TICK_MS;
+    }
+    _ofsm_simulation_virtual_time_advance(sleepPeriod);
+#else
+    _ofsm_debug_printf(4,  "G: Entering sleep for %lu milliseconds...\n", (long unsigned int)sleepPeriod);
+    _ofsm_simulation_sleep(sleepPeriod);
+#endif
+    return 0;
+}/*_ofsm_simulation_command_delay*/
+
+static int _ofsm_simulation_command_wakeup() {
+    if (_ofsmSimulationCompileStream) {
+        _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_WAKEUP);
+        return 1;
+    }
+#if OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE > 0
+    OFSM_CONFIG_CUSTOM_WAKEUP_FUNC();
+    return 1;
+#else
+    printf("ASSERT at line: %i: wakeup command is ignored unless OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE > 0.\n", lineNumber);
+    return 0;
+#endif
+}/*_ofsm_simulation_command_wakeup*/
+
+static int _ofsm_simulation_command_status(OFSM_CONFIG_INDEX_TYPE groupIndex, OFSM_CONFIG_INDEX_TYPE fsmIndex) {
+    OFSMSimulationStatusReport report;
+    if (_ofsmSimulationCompileStream) {
+        _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_STATUS);
+        _ofsm_simulation_script_put_varint(groupIndex);
+        _ofsm_simulation_script_put_varint(fsmIndex);
+        return 1;
+    }
+    _ofsm_simulation_create_status_report(&report, groupIndex, fsmIndex);
+    OFSM_CONFIG_CUSTOM_SIMULATION_CUSTOM_STATUS_REPORT_PRINTER_FUNC(&report);
+    return 1;
+}/*_ofsm_simulation_command_status*/
+
+static int _ofsm_simulation_command_print(const char *s, size_t length) {
+    if (_ofsmSimulationCompileStream) {
+        _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_PRINT);
+        _ofsm_simulation_script_put_string(s, length);
+        return 0;
+    }
+    std::cout.write(s, length);
+    std::cout << std::endl;
+    return 0;
+}/*_ofsm_simulation_command_print*/
+
+#ifdef OFSM_CONFIG_PROFILING
+static int _ofsm_simulation_command_metrics(bool reset, int groupIndex, int fsmIndex) {
+    if (_ofsmSimulationCompileStream) {
+        _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_METRICS);
+        _ofsm_simulation_script_put_varint(reset);
+        _ofsm_simulation_script_put_varint((uint32_t)(groupIndex + 1));
+        _ofsm_simulation_script_put_varint((uint32_t)(fsmIndex + 1));
+        return 1;
+    }
+    if (reset) {
+        ofsm_profile_reset();
+        return 0;
+    }
+    _ofsm_simulation_profile_printer(groupIndex, fsmIndex);
+    return 1;
+}/*_ofsm_simulation_command_metrics*/
+#endif
 
-void _ofsm_simulation_heartbeat_provider_thread(int tickSize) {
-    _OFSM_TIME_DATA_TYPE currentTime = 0;
-    bool doReturn = false;
-    while (1) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(tickSize));
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+static int _ofsm_simulation_command_trace(bool reset, const char *fileName) {
+    if (_ofsmSimulationCompileStream) {
+        _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_TRACE);
+        _ofsm_simulation_script_put_varint(reset);
+        _ofsm_simulation_script_put_string(fileName, strlen(fileName));
+        return 1;
+    }
+    if (reset) {
+        ofsm_trace_reset();
+        return 0;
+    }
+    _ofsm_simulation_trace_file_dump(fileName);
+    return 1;
+}/*_ofsm_simulation_command_trace*/
+#endif
 
+#ifdef OFSM_CONFIG_SNAPSHOT
+static std::string _ofsmSimulationCheckpoint;
+
+/*saves or restores checkpoint once state is consistent: in non script mode ofsm loop runs in its own thread and may be processing*/
+static int _ofsm_simulation_command_checkpoint(bool restore) {
+    char buf[64];
+    bool done = false;
+    bool restored = false;
+    uint32_t size = 0;
+    if (_ofsmSimulationCompileStream) {
+        _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_CHECKPOINT);
+        _ofsm_simulation_script_put_varint(restore);
+        return 1;
+    }
+    while (!done) {
         OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
-            _OFSM_TIME_DATA_TYPE time;
-            ofsm_get_time(time, time);
-            if (time > currentTime) {
-                currentTime = time;
-            }
-            if (_ofsmFlags & _OFSM_FLAG_OFSM_SIMULATION_EXIT) {
-                doReturn = true; /*don't return here, as simulation ATOMIC_BLOCK mutex will remain blocked*/
-            }
-        }
-        if (doReturn) {
 #ifndef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
-            _ofsm_debug_printf(1, "Exiting Heartbeat provider thread...\n");
+            if (!(_ofsmFlags & (_OFSM_FLAG_OFSM_IN_PROCESS | _OFSM_FLAG_OFSM_EVENT_QUEUED)))
 #endif
-            return;
+            {
+                done = true;
+                if (!restore) {
+                    size = ofsm_snapshot_size();
+                    _ofsmSimulationCheckpoint.resize(size);
+                    ofsm_snapshot_save((uint8_t*)&(_ofsmSimulationCheckpoint[0]), size);
+                }
+                else if (!_ofsmSimulationCheckpoint.empty()) {
+                    size = (uint32_t)_ofsmSimulationCheckpoint.length();
+                    restored = ofsm_snapshot_restore((const uint8_t*)_ofsmSimulationCheckpoint.data(), size);
+#ifndef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
+                    if (restored) {
+                        /*time goes on from restored time; ofsm loop re-evaluates restored queues and wakeup time*/
+                        _ofsmSimulationHeartbeatRebase = true;
+#   ifdef OFSM_CONFIG_SIMULATION_TICKLESS
+                        _ofsm_simulation_tickless_rebase();
+#   endif
+                        _ofsmFlags |= _OFSM_FLAG_OFSM_EVENT_QUEUED;
+                        OFSM_CONFIG_CUSTOM_WAKEUP_FUNC();
+                    }
+#endif
+                }
+            }
+        }
+        if (!done) {
+            _ofsm_simulation_sleep(1);
         }
-        currentTime++;
-        ofsm_heartbeat(currentTime);
     }
-}/*_ofsm_simulation_heartbeat_provider_thread*/
+#ifdef OFSM_CONFIG_SIMULATION_TICKLESS
+    if (restored) {
+        _ofsm_simulation_tickless_deadline_published();
+    }
+#endif
+    if (restore && !restored) {
+        printf("ASSERT at line: %i: %s.\n", lineNumber, (_ofsmSimulationCheckpoint.empty() ? "No checkpoint to restore" : "Checkpoint doesn't match OFSM setup"));
+        return 0;
+    }
+    _ofsm_snprintf(buf, (sizeof(buf) / sizeof(*buf)), "-C-%c(%lu)", (restore ? 'R' : 'S'), (unsigned long)size);
+    ofsm_simulation_set_assert_compare_string(buf);
+    std::cout << buf << std::endl;
+    return 1;
+}/*_ofsm_simulation_command_checkpoint*/
+#endif
 
-#ifdef _OFSM_IMPL_EVENT_GENERATOR
-void _ofsm_simulation_sleep_thread(int sleepMilliseconds) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(sleepMilliseconds));
-}/*_ofsm_simulation_sleep_thread*/
+/*processes single line of text script.
+Parsing doesn't allocate: line and token buffers keep their capacity from line to line, tokens point into token buffer
+(copy of the command part of the line, split and trimmed in place), numbers are converted straight from the tokens.
+Returns: 0 - continue with the next line, 1 - exit, -1 - reset*/
+static int _ofsm_simulation_process_line(std::string &line, int &exitCode) {
+    static std::string tokenBuffer;
+    static std::string assertCompareString;
+    static std::string rawLine; /*original command (compile mode)*/
+    const char *tokens[_OFSM_SIMULATION_MAX_TOKEN_COUNT + 1]; /*+1: room for 'queue' shorthand*/
+    uint8_t tCount;
+    const char *t;
+    const char *begin, *end, *pos;
+    char *p, *bufferEnd, *tokenBegin, *tokenEnd;
+    uint8_t i;
+    int checkAssert = 0;
+#ifdef OFSM_CONFIG_CUSTOM_SIMULATION_COMMAND_HOOK_FUNC
+    static std::deque<std::string> hookTokens;
+#endif
 
-void _ofsm_simulation_sleep(int sleepMilliseconds) {
-    std::thread sleepThread(_ofsm_simulation_sleep_thread, sleepMilliseconds);
-    sleepThread.join();
-}/*_ofsm_simulation_sleep*/
+    begin = line.c_str();
+    end = begin + line.length();
+    _ofsm_trim_range(&begin, &end);
 
-int lineNumber = 0;
-std::ifstream fileStream;
+    //strip comments (trailing spaces in front of comment are kept)
+    for (pos = begin; pos + 1 < end; pos++) {
+        if (pos[0] == '/' && pos[1] == '/') {
+            end = pos;
+            break;
+        }
+    }
 
-int _ofsm_simulation_event_generator(const char *fileName) {
-    std::string line;
-    std::string token;
-    int exitCode = 0;
-    std::string assertCompareString;
+    //skip empty lines
+    if (begin == end) {
+        return 0;
+    }
+    if (_ofsmSimulationCompileStream) {
+        rawLine.assign(begin, end - begin);
+    }
 
-    //in case of reset we don't need to open file again
-    if (fileName && !lineNumber) {
-        fileStream.open(fileName);
-        std::cin.rdbuf(fileStream.rdbuf());
+    //get assert string or print string (preserving case)
+    assertCompareString.clear();
+    if ('p' != tolower((unsigned char)*begin)) {
+        /*it is not print, get assert*/
+        pos = (const char*)memchr(begin, '=', end - begin);
+        if (pos) {
+            const char *assertBegin = pos + 1;
+            const char *assertEnd = end;
+            _ofsm_trim_range(&assertBegin, &assertEnd);
+            assertCompareString.assign(assertBegin, assertEnd - assertBegin);
+            end = pos;
+        }
+    }
+    //handle p[rint][,<string to be printed>] ...... command (preserver case)
+    else {
+        pos = (const char*)memchr(begin, ',', end - begin);
+        if (pos) {
+            _ofsm_simulation_command_print(pos + 1, end - pos - 1);
+        }
+        else {
+            _ofsm_simulation_command_print("", 0);
+        }
+        return 0;
     }
-    while (!std::cin.eof())
-    {
 
-        //read line from stdin
-        std::getline(std::cin, line);
-        lineNumber++;
-        trim(line);
+    //convert commands to lower case (kept in line for error messages) and split copy of it by tokens
+    p = &line[0] + (begin - line.c_str());
+    for (bufferEnd = p + (end - begin); p < bufferEnd; p++) {
+        *p = (char)tolower((unsigned char)*p);
+    }
+    tokenBuffer.assign(begin, end - begin);
+    p = &tokenBuffer[0];
+    bufferEnd = p + tokenBuffer.length();
+    tCount = 0;
+    while (p < bufferEnd && tCount < _OFSM_SIMULATION_MAX_TOKEN_COUNT) {
+        tokenBegin = p;
+        while (p < bufferEnd && *p != ',') {
+            p++;
+        }
+        tokenEnd = p;
+        while (tokenBegin < tokenEnd && isspace((unsigned char)*tokenBegin)) {
+            tokenBegin++;
+        }
+        while (tokenEnd > tokenBegin && isspace((unsigned char)tokenEnd[-1])) {
+            tokenEnd--;
+        }
+        *tokenEnd = 0;
+        tokens[tCount++] = tokenBegin;
+        p++; /*skip comma*/
+    }
+    if (p < bufferEnd) {
+        printf("ASSERT at line: %i: Command has more than %i tokens, the rest is ignored.\n", lineNumber, _OFSM_SIMULATION_MAX_TOKEN_COUNT);
+    }
 
-        //prepare for parsing
-        std::string t;
-        std::deque<std::string> tokens;
+    //skip empty lines
+    if (0 >= tCount) {
+        return 0;
+    }
 
-        //strip comments
-        std::size_t commentPos = line.find("//");
-        if (commentPos != std::string::npos) {
-            line.replace(commentPos, line.length(), "");
+#ifdef OFSM_CONFIG_CUSTOM_SIMULATION_COMMAND_HOOK_FUNC
+    /*hook may claim or change any command, so that it can only be called when script is executed*/
+    if (_ofsmSimulationCompileStream) {
+        _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_TEXT);
+        _ofsm_simulation_script_put_string(rawLine.c_str(), rawLine.length());
+        return 0;
+    }
+    hookTokens.clear();
+    for (i = 0; i < tCount; i++) {
+        hookTokens.push_back(tokens[i]);
+    }
+    if (OFSM_CONFIG_CUSTOM_SIMULATION_COMMAND_HOOK_FUNC(hookTokens)) {
+        return 0;
+    }
+    /*hook may change tokens*/
+    tCount = (uint8_t)(hookTokens.size() < _OFSM_SIMULATION_MAX_TOKEN_COUNT ? hookTokens.size() : _OFSM_SIMULATION_MAX_TOKEN_COUNT);
+    for (i = 0; i < tCount; i++) {
+        tokens[i] = hookTokens[i].c_str();
+    }
+    if (0 >= tCount) {
+        return 0;
+    }
+#endif
+    //if line starts with digit, assume shorthand of 'queue' command: eventCode[,eventData[,groupIndex]]
+    if (strstr("0123456789", tokens[0])) {
+        for (i = tCount; i > 0; i--) {
+            tokens[i] = tokens[i - 1];
         }
+        tokens[0] = "queue";
+        tCount++;
+    }
 
-        //skip empty lines
-        if (!line.length()) {
-            continue;
-        }
+    //parse command
+    t = tokens[0];
 
-        //get assert string or print string (preserving case)
-        t = line;
-        toLower(t);
-        assertCompareString = "";
-        if (0 != t.find("p")) {
-            /*it is not print, get assert*/
-            std::size_t assertComparePos = line.find("=");
-            if (assertComparePos != std::string::npos) {
-                assertCompareString = line.substr(assertComparePos + 1);
-                trim(assertCompareString);
-                line.replace(assertComparePos, line.length(), "");
-            }
+    switch (t[0]) {
+    case 'e':			//e[xit]
+    {
+        if (_ofsmSimulationCompileStream) {
+            _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_EXIT);
         }
-        //handle p[rint][,<string to be printed>] ...... command (preserver case)
-        else {
-            std::size_t commaPos = line.find(",");
-            if (commaPos != std::string::npos) {
-                assertCompareString = line.substr(commaPos + 1);
-            }
-            std::cout << assertCompareString << std::endl;
-            continue;
+        _ofsm_debug_printf(4,  "G: Exiting...\n");
+        return 1;
+    }
+    break;
+    case 'w':			//w[akeup]
+    {
+        checkAssert = _ofsm_simulation_command_wakeup();
+    }
+    break;
+    case 'd':			//d[elay][,sleepPeriod]
+    {
+        _OFSM_TIME_DATA_TYPE sleepPeriod = 0;
+        if (tCount > 1) {
+            sleepPeriod = atoi(tokens[1]);
         }
-
-        //convert commands to lower case
-        toLower(line);
-        std::stringstream strStream(line);
-
-        //parse by tokens
-        while (std::getline(strStream, token, ',')) {
-            if (token.find_first_not_of(' ') >= 0) {
-                tokens.push_back(trim(token));
+        if (0 == sleepPeriod) {
+            sleepPeriod = 1000;
+        }
+        checkAssert = _ofsm_simulation_command_delay(sleepPeriod);
+    }
+    break;
+//    case 'p':			//p[rint]
+//    break;
+    case 'q':			//q[ueue][,[mods],eventCode[,eventData[,groupIndex]]]
+    {
+        OFSM_CONFIG_INDEX_TYPE eventCode = 0;
+        uint8_t eventData = 0;
+        uint8_t eventCodeIndex = 1;
+        OFSM_CONFIG_INDEX_TYPE groupIndex = 0;
+        uint8_t mods = 0;
+        if (tCount > 1) {
+            t = tokens[1];
+            mods |= (NULL != strchr(t, 'g') ? _OFSM_SCRIPT_QUEUE_GLOBAL : 0);
+            mods |= (NULL != strchr(t, 'f') ? _OFSM_SCRIPT_QUEUE_FORCE : 0);
+            if (mods) {
+                eventCodeIndex = 2;
             }
         }
-
-        //skip empty lines
-        if (0 >= tokens.size()) {
-            continue;
+        //get eventCode
+        if (tCount > eventCodeIndex) {
+            t = tokens[eventCodeIndex];
+            eventCodeIndex++;
+            eventCode = atoi(t);
         }
-
-#ifdef OFSM_CONFIG_CUSTOM_SIMULATION_COMMAND_HOOK_FUNC
-        if (OFSM_CONFIG_CUSTOM_SIMULATION_COMMAND_HOOK_FUNC(tokens)) {
-            continue;
+        //get eventData
+        if (tCount > eventCodeIndex) {
+            t = tokens[eventCodeIndex];
+            eventCodeIndex++;
+            eventData = atoi(t);
+        }
+        //get groupIndex
+        if (tCount > eventCodeIndex) {
+            t = tokens[eventCodeIndex];
+            eventCodeIndex++;
+            groupIndex = atoi(t);
+            mods |= _OFSM_SCRIPT_QUEUE_GROUP;
+        }
+        //queue event
+        checkAssert = _ofsm_simulation_command_queue(mods, eventCode, eventData, groupIndex);
+    }
+    break;
+    case 'h':			// h[eartbeat][,currentTime]
+    {
+        checkAssert = _ofsm_simulation_command_heartbeat(tCount > 1, (tCount > 1 ? (_OFSM_TIME_DATA_TYPE)strtoull(tokens[1], NULL, 10) : 0));
+    }
+    break;
+    case 's':			//s[tatus][,groupIndex[,fsmIndex]]
+    {
+        OFSM_CONFIG_INDEX_TYPE groupIndex = 0;
+        OFSM_CONFIG_INDEX_TYPE fsmIndex = 0;
+        //get group index
+        if (tCount > 1) {
+            t = tokens[1];
+            groupIndex = atoi(t);
+        }
+        //get fsm index
+        if (tCount > 2) {
+            t = tokens[2];
+            fsmIndex = atoi(t);
+        }
+        checkAssert = _ofsm_simulation_command_status(groupIndex, fsmIndex);
+    }
+    break;
+#ifdef OFSM_CONFIG_PROFILING
+    case 'm':			//m[etrics][,r|groupIndex[,fsmIndex]]
+    {
+        int groupIndex = -1;
+        int fsmIndex = -1;
+        bool reset = (tCount > 1 && !strcmp(tokens[1], "r"));
+        //get group index
+        if (tCount > 1 && !reset) {
+            t = tokens[1];
+            groupIndex = atoi(t);
         }
+        //get fsm index
+        if (tCount > 2 && !reset) {
+            t = tokens[2];
+            fsmIndex = atoi(t);
+        }
+        checkAssert = _ofsm_simulation_command_metrics(reset, groupIndex, fsmIndex);
+    }
+    break;
+#endif
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+    case 't':			//t[race][,r|fileName]
+    {
+        bool reset = (tCount > 1 && !strcmp(tokens[1], "r"));
+        checkAssert = _ofsm_simulation_command_trace(reset, (tCount > 1 && !reset ? tokens[1] : "ofsm.trace"));
+    }
+    break;
+#endif
+#ifdef OFSM_CONFIG_SNAPSHOT
+    case 'c':			//c[heckpoint][,r]
+    {
+        checkAssert = _ofsm_simulation_command_checkpoint(tCount > 1 && !strcmp(tokens[1], "r"));
+    }
+    break;
 #endif
-        //if line starts with digit, assume shorthand of 'queue' command: eventCode[,eventData[,groupIndex]]
-        std::string digits = "0123456789";
-        if (std::string::npos != digits.find(tokens[0])) {
-            tokens.push_front("queue");
+    case 'r':			//r[eset]
+    {
+        if (_ofsmSimulationCompileStream) {
+            _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_RESET);
+            return 0;
+        }
+        return -1; /*repeat main loop*/
+    }
+    break;
+    default:			//Unrecognized command!!!
+    {
+        if (_ofsmSimulationCompileStream) {
+            _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_TEXT);
+            _ofsm_simulation_script_put_string(rawLine.c_str(), rawLine.length());
+            return 0;
+        }
+        printf("ASSERT at line: %i: Invalid Command '%.*s' ignored.\n", lineNumber, (int)(end - begin), begin);
+        return 0;
+    }
+    break;
+    }
+
+    //check for assert
+    if (assertCompareString.length() > 0) {
+        if (_ofsmSimulationCompileStream) {
+            _ofsm_simulation_script_put_op(_OFSM_SCRIPT_OP_ASSERT);
+            _ofsm_simulation_script_put_string(assertCompareString.c_str(), assertCompareString.length());
+            return 0;
+        }
+        if (!checkAssert) {
+            return 0;
         }
+        exitCode += _ofsm_simulation_check_for_assert(assertCompareString, lineNumber);
+    }
+    if (!checkAssert) {
+        return 0;
+    }
+
+#if OFSM_CONFIG_SIMULATION_SCRIPT_MODE_SLEEP_BETWEEN_EVENTS_MS > 0
+    _ofsm_simulation_sleep(OFSM_CONFIG_SIMULATION_SCRIPT_MODE_SLEEP_BETWEEN_EVENTS_MS);
+#endif
+    return 0;
+}/*_ofsm_simulation_process_line*/
 
-        //parse command
-        t = tokens[0];
-        uint8_t tCount = (uint8_t)tokens.size();
+/*compiles text script into binary script (simulation executable arguments: -c <text script> <binary script>)*/
+int _ofsm_simulation_compile_script(const char *textFileName, const char *binaryFileName) {
+    std::ifstream in(textFileName);
+    std::ofstream out(binaryFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    std::string line;
+    int exitCode = 0;
 
-        switch (t[0]) {
-        case 'e':			//e[xit]
-        {
-            _ofsm_debug_printf(4,  "G: Exiting...\n");
-            return exitCode;
+    if (!in.is_open() || !out.is_open()) {
+        std::cerr << "Cannot open '" << (in.is_open() ? binaryFileName : textFileName) << "'." << std::endl;
+        return 1;
+    }
+    out.write("OFSB", 4);
+    out.put((char)_OFSM_SCRIPT_VERSION);
+    out.write("\0\0\0", 3);
+    _ofsmSimulationCompileStream = &out;
+    lineNumber = 0;
+    _ofsmSimulationCompiledLineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        if (_ofsm_simulation_process_line(line, exitCode) > 0) {
+            break; /*exit: the rest of the script is never executed*/
         }
-        break;
-        case 'w':			//w[akeup]
-        {
-#	        if OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE > 0
-                OFSM_CONFIG_CUSTOM_WAKEUP_FUNC();
-#	        else
-                printf("ASSERT at line: %i: wakeup command is ignored unless OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE > 0.\n", lineNumber);
-                continue;
-#			endif
+    }
+    _ofsmSimulationCompileStream = NULL;
+    std::cerr << "Compiled " << lineNumber << " lines into " << (long)out.tellp() << " bytes." << std::endl;
+    lineNumber = 0;
+    return 0;
+}/*_ofsm_simulation_compile_script*/
+
+/*binary script image: mapped into memory, executed without any text processing*/
+static const uint8_t *_ofsmSimulationScript;
+static size_t _ofsmSimulationScriptSize;
+static size_t _ofsmSimulationScriptPosition;
+
+static bool _ofsm_simulation_script_map(const char *fileName) {
+#ifdef _MSC_VER
+    static std::vector<uint8_t> image;
+    std::ifstream in(fileName, std::ios::in | std::ios::binary);
+    image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (image.size() <= 8) {
+        return false;
+    }
+    _ofsmSimulationScript = image.data();
+    _ofsmSimulationScriptSize = image.size();
+#else
+    struct stat st;
+    void *image;
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size <= 8) {
+        close(fd);
+        return false;
+    }
+    image = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        return false;
+    }
+    madvise(image, (size_t)st.st_size, MADV_SEQUENTIAL);
+    _ofsmSimulationScript = (const uint8_t*)image;
+    _ofsmSimulationScriptSize = (size_t)st.st_size;
+#endif
+    _ofsmSimulationScriptPosition = 8; /*skip header*/
+    return true;
+}/*_ofsm_simulation_script_map*/
+
+/*set when read goes past the end of the image or varint is longer than 64 bits; reads return 0 (empty string) afterwards*/
+static bool _ofsmSimulationScriptCorrupted;
+
+static inline uint64_t _ofsm_simulation_script_get_varint() {
+    uint64_t value = 0;
+    uint8_t shift = 0;
+    uint8_t b;
+    do {
+        if (_ofsmSimulationScriptPosition >= _ofsmSimulationScriptSize || shift > 63) {
+            _ofsmSimulationScriptCorrupted = true;
+            return 0;
         }
-        break;
-        case 'd':			//d[elay][,sleepPeriod]
-        {
-            _OFSM_TIME_DATA_TYPE sleepPeriod = 0;
-            if (tCount > 1) {
-                sleepPeriod = atoi(tokens[1].c_str());
-            }
-            if (0 == sleepPeriod) {
-                sleepPeriod = 1000;
-            }
-            _ofsm_debug_printf(4,  "G: Entering sleep for %lu milliseconds...\n", (long unsigned int)sleepPeriod);
-            _ofsm_simulation_sleep(sleepPeriod);
-            continue;
+        b = _ofsmSimulationScript[_ofsmSimulationScriptPosition++];
+        value |= (uint64_t)(b & 0x7F) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    return value;
+}/*_ofsm_simulation_script_get_varint*/
+
+static inline const char *_ofsm_simulation_script_get_string(size_t *length) {
+    const char *s;
+    *length = (size_t)_ofsm_simulation_script_get_varint();
+    if (_ofsmSimulationScriptCorrupted || *length > _ofsmSimulationScriptSize - _ofsmSimulationScriptPosition) {
+        _ofsmSimulationScriptCorrupted = true;
+        *length = 0;
+        return "";
+    }
+    s = (const char*)_ofsmSimulationScript + _ofsmSimulationScriptPosition;
+    _ofsmSimulationScriptPosition += *length;
+    return s;
+}/*_ofsm_simulation_script_get_string*/
+
+/*operands of every operation: 'v' - varint, 's' - string; indexed by opcode*/
+static const char *const _ofsmSimulationScriptOperands[] = {
+    NULL, "vvvv", "", "v", "v", "", "vv", "s", "s", "", "", "s", "vvv", "vs", "v"
+};
+
+/*walks the whole image before anything is executed, so that truncated or corrupted script is not replayed partially.
+Returns 0 if image is valid, otherwise prints assert message and returns 1*/
+static int _ofsm_simulation_script_validate() {
+    const char *operand;
+    size_t length;
+    uint8_t op = 0;
+    int line = 0;
+
+    _ofsmSimulationScriptCorrupted = false;
+    if (_ofsmSimulationScript[4] != _OFSM_SCRIPT_VERSION) {
+        printf("ASSERT at line: 0: Unsupported binary script version %i (expected %i). Replay is aborted.\n", _ofsmSimulationScript[4], _OFSM_SCRIPT_VERSION);
+        return 1;
+    }
+    while (!_ofsmSimulationScriptCorrupted && _ofsmSimulationScriptPosition < _ofsmSimulationScriptSize) {
+        op = _ofsmSimulationScript[_ofsmSimulationScriptPosition++];
+        line += (int)_ofsm_simulation_script_get_varint();
+        if (!op || op >= sizeof(_ofsmSimulationScriptOperands) / sizeof(*_ofsmSimulationScriptOperands)) {
+            _ofsmSimulationScriptCorrupted = true;
+            break;
         }
-        break;
-//        case 'p':			//p[rint]
-//        break;
-        case 'q':			//q[ueue][,[mods],eventCode[,eventData[,groupIndex]]]
-        {
-            uint8_t eventCode = 0;
-            uint8_t eventData = 0;
-            uint8_t eventCodeIndex = 1;
-            uint8_t groupIndex = 0;
-            bool isGlobal = false;
-            bool forceNew = false;
-            if (tCount > 1) {
-                t = tokens[1];
-                isGlobal = std::string::npos != t.find("g");
-                forceNew = std::string::npos != t.find("f");
-                if (isGlobal || forceNew) {
-                    eventCodeIndex = 2;
-                }
-            }
-            //get eventCode
-            if (tCount > eventCodeIndex) {
-                t = tokens[eventCodeIndex];
-                eventCodeIndex++;
-                eventCode = atoi(t.c_str());
-            }
-            //get eventData
-            if (tCount > eventCodeIndex) {
-                t = tokens[eventCodeIndex];
-                eventCodeIndex++;
-                eventData = atoi(t.c_str());
-            }
-            //get groupIndex
-            if (tCount > eventCodeIndex) {
-                t = tokens[eventCodeIndex];
-                eventCodeIndex++;
-                groupIndex = atoi(t.c_str());
-                if (groupIndex >= _ofsmGroupCount) {
-                    printf("ASSERT at line: %i: Invalid Group Index %i.\n", lineNumber, groupIndex);
-                    continue;
-                }
-            }
-            //queue event
-            if (isGlobal) {
-                ofsm_queue_global_event(forceNew, eventCode, eventData);
+        for (operand = _ofsmSimulationScriptOperands[op]; *operand; operand++) {
+            if (*operand == 's') {
+                _ofsm_simulation_script_get_string(&length);
             }
             else {
-                ofsm_queue_group_event(groupIndex, forceNew, eventCode, eventData);
+                _ofsm_simulation_script_get_varint();
             }
         }
-        break;
-        case 'h':			// h[eartbeat][,currentTime]
-        {
-            _OFSM_TIME_DATA_TYPE currentTime;
-            if (tCount > 1) {
-                t = tokens[1];
-                currentTime = atoi(t.c_str());
-            }
-            else {
-                OFSM_CONFIG_ATOMIC_BLOCK(OFSM_CONFIG_ATOMIC_RESTORESTATE) {
-                    currentTime = _ofsmTime + 1;
-                }
+    }
+    _ofsmSimulationScriptPosition = 8; /*skip header*/
+    if (_ofsmSimulationScriptCorrupted) {
+        printf("ASSERT at line: %i: Binary script is truncated or corrupted (operation %i). Replay is aborted.\n", line, op);
+        return 1;
+    }
+    return 0;
+}/*_ofsm_simulation_script_validate*/
+
+/*executes binary script from current position. Returns: 0 - end of script or exit, -1 - reset*/
+static int _ofsm_simulation_replay(int &exitCode) {
+    static std::string line; /*text operation*/
+    std::string assertCompareString;
+    uint8_t op;
+    int checkAssert = 0;
+    uint8_t mods;
+    OFSM_CONFIG_INDEX_TYPE code;
+    uint8_t data;
+    const char *s;
+    size_t length;
+    int ret;
+
+    while (_ofsmSimulationScriptPosition < _ofsmSimulationScriptSize) {
+        op = _ofsmSimulationScript[_ofsmSimulationScriptPosition++];
+        lineNumber += (int)_ofsm_simulation_script_get_varint();
+        if (op != _OFSM_SCRIPT_OP_ASSERT) {
+#if OFSM_CONFIG_SIMULATION_SCRIPT_MODE_SLEEP_BETWEEN_EVENTS_MS > 0
+            if (checkAssert) {
+                _ofsm_simulation_sleep(OFSM_CONFIG_SIMULATION_SCRIPT_MODE_SLEEP_BETWEEN_EVENTS_MS);
             }
-            ofsm_heartbeat(currentTime);
+#endif
+            checkAssert = 0;
         }
-        break;
-        case 's':			//s[tatus][,groupIndex[,fsmIndex]]
-        {
-            OFSMSimulationStatusReport report;
-            uint8_t groupIndex = 0;
-            uint8_t fsmIndex = 0;
-            //get group index
-            if (tCount > 1) {
-                t = tokens[1];
-                groupIndex = atoi(t.c_str());
+        switch (op) {
+        case _OFSM_SCRIPT_OP_QUEUE:
+            mods = (uint8_t)_ofsm_simulation_script_get_varint();
+            code = (OFSM_CONFIG_INDEX_TYPE)_ofsm_simulation_script_get_varint();
+            data = (uint8_t)_ofsm_simulation_script_get_varint();
+            checkAssert = _ofsm_simulation_command_queue(mods, code, data, (OFSM_CONFIG_INDEX_TYPE)_ofsm_simulation_script_get_varint());
+            break;
+        case _OFSM_SCRIPT_OP_HEARTBEAT:
+            checkAssert = _ofsm_simulation_command_heartbeat(false, 0);
+            break;
+        case _OFSM_SCRIPT_OP_HEARTBEAT_AT:
+            checkAssert = _ofsm_simulation_command_heartbeat(true, (_OFSM_TIME_DATA_TYPE)_ofsm_simulation_script_get_varint());
+            break;
+        case _OFSM_SCRIPT_OP_DELAY:
+            checkAssert = _ofsm_simulation_command_delay((_OFSM_TIME_DATA_TYPE)_ofsm_simulation_script_get_varint());
+            break;
+        case _OFSM_SCRIPT_OP_WAKEUP:
+            checkAssert = _ofsm_simulation_command_wakeup();
+            break;
+        case _OFSM_SCRIPT_OP_STATUS:
+            code = (OFSM_CONFIG_INDEX_TYPE)_ofsm_simulation_script_get_varint();
+            checkAssert = _ofsm_simulation_command_status(code, (OFSM_CONFIG_INDEX_TYPE)_ofsm_simulation_script_get_varint());
+            break;
+        case _OFSM_SCRIPT_OP_PRINT:
+            s = _ofsm_simulation_script_get_string(&length);
+            _ofsm_simulation_command_print(s, length);
+            break;
+        case _OFSM_SCRIPT_OP_ASSERT:
+            s = _ofsm_simulation_script_get_string(&length);
+            if (checkAssert) {
+                assertCompareString.assign(s, length);
+                exitCode += _ofsm_simulation_check_for_assert(assertCompareString, lineNumber);
             }
-            //get fsm index
-            if (tCount > 2) {
-                t = tokens[2];
-                fsmIndex = atoi(t.c_str());
+            break;
+        case _OFSM_SCRIPT_OP_RESET:
+            return -1;
+        case _OFSM_SCRIPT_OP_EXIT:
+            _ofsm_debug_printf(4,  "G: Exiting...\n");
+            _ofsmSimulationScriptPosition = _ofsmSimulationScriptSize;
+            return 0;
+        case _OFSM_SCRIPT_OP_TEXT:
+            s = _ofsm_simulation_script_get_string(&length);
+            line.assign(s, length);
+            ret = _ofsm_simulation_process_line(line, exitCode);
+            if (ret) {
+                return (ret < 0 ? ret : 0);
             }
-            _ofsm_simulation_create_status_report(&report, groupIndex, fsmIndex);
-
-            OFSM_CONFIG_CUSTOM_SIMULATION_CUSTOM_STATUS_REPORT_PRINTER_FUNC(&report);
-        }
-        break;
-        case 'r':			//r[eset]
+            break;
+#ifdef OFSM_CONFIG_PROFILING
+        case _OFSM_SCRIPT_OP_METRICS:
         {
-            return -1; /*repeat main loop*/
+            bool reset = _ofsm_simulation_script_get_varint() > 0;
+            int groupIndex = (int)(uint32_t)_ofsm_simulation_script_get_varint() - 1;
+            checkAssert = _ofsm_simulation_command_metrics(reset, groupIndex, (int)(uint32_t)_ofsm_simulation_script_get_varint() - 1);
         }
         break;
-        default:			//Unrecognized command!!!
+#endif
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+        case _OFSM_SCRIPT_OP_TRACE:
         {
-            printf("ASSERT at line: %i: Invalid Command '%s' ignored.\n", lineNumber, line.c_str());
-            continue;
+            bool reset = _ofsm_simulation_script_get_varint() > 0;
+            s = _ofsm_simulation_script_get_string(&length);
+            line.assign(s, length);
+            checkAssert = _ofsm_simulation_command_trace(reset, line.c_str());
         }
         break;
+#endif
+#ifdef OFSM_CONFIG_SNAPSHOT
+        case _OFSM_SCRIPT_OP_CHECKPOINT:
+            checkAssert = _ofsm_simulation_command_checkpoint(_ofsm_simulation_script_get_varint() > 0);
+            break;
+#endif
+        default:
+            printf("ASSERT at line: %i: Invalid binary script operation %i. Replay is aborted.\n", lineNumber, op);
+            _ofsmSimulationScriptPosition = _ofsmSimulationScriptSize;
+            return 0;
         }
+    }
+    return 0;
+}/*_ofsm_simulation_replay*/
 
+int _ofsm_simulation_event_generator(const char *fileName) {
+    std::string line;
+    int exitCode = 0;
+    int ret;
+    char magic[4] = { 0 };
 
-        //check for assert
-        if (assertCompareString.length() > 0) {
-            exitCode += _ofsm_simulation_check_for_assert(assertCompareString, lineNumber);
+    //in case of reset we don't need to open file again
+    if (fileName && !lineNumber) {
+        fileStream.open(fileName, std::ios::in | std::ios::binary);
+        fileStream.read(magic, sizeof(magic));
+        if (!memcmp(magic, "OFSB", sizeof(magic))) {
+            fileStream.close();
+            if (!_ofsm_simulation_script_map(fileName)) {
+                std::cerr << "Cannot map binary script '" << fileName << "'." << std::endl;
+                return 1;
+            }
+            if (_ofsm_simulation_script_validate()) {
+                _ofsmSimulationScriptPosition = _ofsmSimulationScriptSize; /*nothing gets replayed, not even after reset*/
+                return 1;
+            }
+        }
+        else {
+            fileStream.clear();
+            fileStream.seekg(0);
+            std::cin.rdbuf(fileStream.rdbuf());
+        }
+    }
+    if (_ofsmSimulationScript) {
+        ret = _ofsm_simulation_replay(exitCode);
+        return (ret < 0 ? ret : exitCode);
+    }
+    while (!std::cin.eof())
+    {
+        //read line from stdin
+        std::getline(std::cin, line);
+        lineNumber++;
+        ret = _ofsm_simulation_process_line(line, exitCode);
+        if (ret) {
+            return (ret < 0 ? ret : exitCode);
         }
-
-#if OFSM_CONFIG_SIMULATION_SCRIPT_MODE_SLEEP_BETWEEN_EVENTS_MS > 0
-        _ofsm_simulation_sleep(OFSM_CONFIG_SIMULATION_SCRIPT_MODE_SLEEP_BETWEEN_EVENTS_MS);
-#endif
-
     }
 
     return exitCode;
@@ -928,14 +3442,26 @@ int _ofsm_simulation_event_generator(const char *fileName) {
 int main(int argc, char* argv[])
 {
     int retCode = 0;
+#ifdef _OFSM_IMPL_EVENT_GENERATOR
+    if (argc == 4 && !strcmp(argv[1], "-c")) {
+        return _ofsm_simulation_compile_script(argv[2], argv[3]); /*compile only, OFSM is not started*/
+    }
+#endif
     do {
 #ifndef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
+#   ifdef OFSM_CONFIG_SIMULATION_TICKLESS
+        _ofsm_simulation_tickless_reset();
+#   endif
         //start fsm thread
         std::thread fsmThread(_ofsm_simulation_fsm_thread, 0);
         fsmThread.detach();
 
         //start timer thread
+#   ifdef OFSM_CONFIG_SIMULATION_TICKLESS
+        std::thread heartbeatProviderThread(_ofsm_simulation_tickless_heartbeat_provider_thread, OFSM_CONFIG_SIMULATION_TICK_MS);
+#   else
         std::thread heartbeatProviderThread(_ofsm_simulation_heartbeat_provider_thread, OFSM_CONFIG_SIMULATION_TICK_MS);
+#   endif
         heartbeatProviderThread.detach();
 #else
         //perform setup and make first iteration through the OFSM
@@ -965,6 +3491,9 @@ int main(int argc, char* argv[])
             OFSM_CONFIG_CUSTOM_WAKEUP_FUNC();
 #endif
         }
+#ifdef OFSM_CONFIG_SIMULATION_TICKLESS
+        _ofsm_simulation_tickless_deadline_published(); /*wake up heartbeat provider, so that it exits*/
+#endif
 
 #ifndef OFSM_CONFIG_SIMULATION_SCRIPT_MODE
         _ofsm_debug_printf(3, "Waiting for %i milliseconds for all threads to exit...\n", OFSM_CONFIG_SIMULATION_TICK_MS);
@@ -975,23 +3504,35 @@ int main(int argc, char* argv[])
             _ofsm_debug_printf(3, "Reseting...\n");
 
 			/*In simulation mode, we need to allow to reset OFSM to initial state, so that intermediate test case can start clean.*/
-			uint8_t i, k;
+			OFSM_CONFIG_INDEX_TYPE i, k;
 			OFSMGroup *group;
 			OFSM *fsm;
 			/*reset GLOBALS*/
 			_ofsmFlags = (_OFSM_FLAG_INFINITE_SLEEP | _OFSM_FLAG_OFSM_FIRST_ITERATION);
 			_ofsmTime = 0;
 			_ofsmWakeupTime = 0;
+#ifdef OFSM_CONFIG_PROFILING
+			ofsm_profile_reset();
+#endif
+#ifdef OFSM_CONFIG_TRACE_BUFFER_SIZE
+			ofsm_trace_reset();
+#endif
 			/*reset groups and FSMs*/
 			for (i = 0; i < _ofsmGroupCount; i++) {
 				group = (_ofsmGroups)[i];
 				group->flags = 0;
 				group->currentEventIndex = group->nextEventIndex = 0;
+#ifdef OFSM_CONFIG_FSM_POOL
+				if (group->pool) {
+					_ofsm_pool_reset(group);
+					continue;
+				}
+#endif
 				for (k = 0; k < group->groupSize; k++) {
 					fsm = (group->fsms)[k];
 					fsm->flags = (_OFSM_FLAG_INFINITE_SLEEP);
 					fsm->currentState = fsm->simulationInitialState;
-					fsm->skipNextEventCode = (uint8_t)-1;
+					fsm->skipNextEventCode = (OFSM_CONFIG_INDEX_TYPE)-1;
 					fsm->wakeupTime = 0;
 				}
 			}
@@ -1111,7 +3652,7 @@ unsigned long sleepPeriodUs;
 
 static unsigned long _ofsmTimerStartTimeUs;
 static unsigned long _ofsmSleepPeriodUs;
-static unsigned long _ofsmTimeBeforeSleep;
+static _OFSM_TIME_DATA_TYPE _ofsmTimeBeforeSleep;
 
 static inline unsigned long _ofsm_sleep_timer_set() {
     _ofsmTimerStartTimeUs = OFSM_CONFIG_CUSTOM_MICROS_FUNC();
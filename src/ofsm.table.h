@@ -0,0 +1,201 @@
+/*------------------------------------------------
+Compile-time transition table (C++11).
+
+Opt-in front end that builds a compact transition table at compile time:
+* every cell takes 2 bytes {handler index, new state} instead of {handler pointer, new state};
+* handler pointers are stored once, in the handler array of the table;
+* table is validated by static_assert: state, new state and event code must be in range,
+  handler must be listed in the handler array and transitions must be sorted by state, then by event code (without duplicates).
+
+Define OFSM_CONFIG_COMPACT_TRANSITION_TABLE in OFSM configuration section (before ofsm.decl.h is included)
+and include ofsm.table.h after ofsm.decl.h.
+
+Example:
+    enum Events {Timeout = 0, Button, EventCount};
+    enum States {Off = 0, On, StateCount};
+
+    void TurnOn();
+    void TurnOff();
+
+    constexpr OFSMHandler lampHandlers[] = { TurnOn, TurnOff };
+    constexpr OFSMTableTransition lampTransitions[] = {
+        ofsm_transition(Off, Button, TurnOn, On),
+        ofsm_transition(On, Button, TurnOff, Off),
+        ofsm_nop_transition(On, Timeout, Off),
+    };
+
+    OFSM_DECLARE_COMPACT_TRANSITION_TABLE(Lamp, lampHandlers, lampTransitions, StateCount, EventCount);
+    OFSM_DECLARE_COMPACT_FSM(LampFsm, Lamp, NULL, NULL, Off);
+
+Cells that are not listed get no handler ({0, 0} in regular table).
+Handler array may hold up to 254 handlers.
+With OFSM_CONFIG_TRANSITION_TABLE_IN_FLASH cells are placed in program memory; handler array must be declared with OFSM_FLASH too.
+-------------------------------------------------*/
+#ifndef __OFSM_TABLE_H_
+#define __OFSM_TABLE_H_
+
+#ifndef OFSM_CONFIG_COMPACT_TRANSITION_TABLE
+#   error "OFSM_CONFIG_COMPACT_TRANSITION_TABLE must be defined before ofsm.decl.h is included"
+#endif
+
+/*--------------------------------
+Type definitions
+----------------------------------*/
+struct OFSMTableTransition {
+    OFSM_CONFIG_INDEX_TYPE  state;
+    OFSM_CONFIG_INDEX_TYPE  eventCode;
+    OFSMHandler             eventHandler;
+    OFSM_CONFIG_INDEX_TYPE  newState;
+    uint8_t                 nop;            /*transition uses OFSM_NOP_HANDLER*/
+};
+
+constexpr OFSMTableTransition ofsm_transition(OFSM_CONFIG_INDEX_TYPE state, OFSM_CONFIG_INDEX_TYPE eventCode, OFSMHandler eventHandler, OFSM_CONFIG_INDEX_TYPE newState) {
+    return OFSMTableTransition{ state, eventCode, eventHandler, newState, 0 };
+}
+
+constexpr OFSMTableTransition ofsm_nop_transition(OFSM_CONFIG_INDEX_TYPE state, OFSM_CONFIG_INDEX_TYPE eventCode, OFSM_CONFIG_INDEX_TYPE newState) {
+    return OFSMTableTransition{ state, eventCode, nullptr, newState, 1 };
+}
+
+/*------------------------------------------------
+Compile time helpers.
+C++11 constexpr functions can't loop, so lookups and checks split ranges in halves: recursion depth stays log2(n).
+-------------------------------------------------*/
+template<unsigned... I> struct _OFSMIndexSequence {};
+
+template<class A, class B> struct _OFSMIndexSequenceConcat;
+template<unsigned... A, unsigned... B> struct _OFSMIndexSequenceConcat<_OFSMIndexSequence<A...>, _OFSMIndexSequence<B...> > {
+    typedef _OFSMIndexSequence<A..., (sizeof...(A) + B)...> type;
+};
+
+template<unsigned N> struct _OFSMMakeIndexSequence {
+    typedef typename _OFSMIndexSequenceConcat<typename _OFSMMakeIndexSequence<N / 2>::type, typename _OFSMMakeIndexSequence<N - N / 2>::type>::type type;
+};
+template<> struct _OFSMMakeIndexSequence<0> { typedef _OFSMIndexSequence<> type; };
+template<> struct _OFSMMakeIndexSequence<1> { typedef _OFSMIndexSequence<0> type; };
+
+constexpr unsigned _ofsm_table_first_found(unsigned a, unsigned b, unsigned notFound) {
+    return a != notFound ? a : b;
+}
+
+/*sort key: state, then event code (index type is up to 32 bits wide)*/
+constexpr unsigned long long _ofsm_table_make_key(unsigned long long state, unsigned long long eventCode) {
+    return (state << 32) | eventCode;
+}
+
+constexpr unsigned long long _ofsm_table_key(const OFSMTableTransition &t) {
+    return _ofsm_table_make_key(t.state, t.eventCode);
+}
+
+/*binary search of transition with given key within [lo, hi) of sorted transitions; TN if not found*/
+template<unsigned TN>
+constexpr unsigned _ofsm_table_find_transition(const OFSMTableTransition (&t)[TN], unsigned long long key, unsigned lo, unsigned hi) {
+    return hi <= lo ? TN
+        : _ofsm_table_key(t[lo + (hi - lo) / 2]) == key ? lo + (hi - lo) / 2
+        : _ofsm_table_key(t[lo + (hi - lo) / 2]) < key ? _ofsm_table_find_transition(t, key, lo + (hi - lo) / 2 + 1, hi)
+        : _ofsm_table_find_transition(t, key, lo, lo + (hi - lo) / 2);
+}
+
+/*index of handler within [lo, hi); HN if not found*/
+template<unsigned HN>
+constexpr unsigned _ofsm_table_find_handler(const OFSMHandler (&h)[HN], OFSMHandler eventHandler, unsigned lo, unsigned hi) {
+    return hi <= lo ? HN
+        : hi - lo == 1 ? (h[lo] == eventHandler ? lo : HN)
+        : _ofsm_table_first_found(
+            _ofsm_table_find_handler(h, eventHandler, lo, lo + (hi - lo) / 2),
+            _ofsm_table_find_handler(h, eventHandler, lo + (hi - lo) / 2, hi), HN);
+}
+
+template<unsigned TN, unsigned HN>
+constexpr OFSMCompactTransition _ofsm_table_encode(const OFSMTableTransition (&t)[TN], const OFSMHandler (&h)[HN], unsigned k) {
+    return k == TN ? OFSMCompactTransition{ 0, 0 }
+        : OFSMCompactTransition{
+            (uint8_t)(t[k].nop ? OFSM_COMPACT_NOP_HANDLER_INDEX : _ofsm_table_find_handler(h, t[k].eventHandler, 0, HN) + 1),
+            t[k].newState };
+}
+
+/*cell i of (stateCount x eventCount) table*/
+template<unsigned TN, unsigned HN>
+constexpr OFSMCompactTransition _ofsm_table_cell(const OFSMTableTransition (&t)[TN], const OFSMHandler (&h)[HN], unsigned eventCount, unsigned i) {
+    return _ofsm_table_encode(t, h, _ofsm_table_find_transition(t, _ofsm_table_make_key(i / eventCount, i % eventCount), 0, TN));
+}
+
+/*validation: every transition within [lo, hi) passes Check*/
+struct _OFSMTableCheckState {
+    template<unsigned TN, unsigned HN>
+    static constexpr bool check(const OFSMTableTransition (&t)[TN], const OFSMHandler (&)[HN], unsigned stateCount, unsigned, unsigned k) {
+        return t[k].state < stateCount && t[k].newState < stateCount;
+    }
+};
+
+struct _OFSMTableCheckEvent {
+    template<unsigned TN, unsigned HN>
+    static constexpr bool check(const OFSMTableTransition (&t)[TN], const OFSMHandler (&)[HN], unsigned, unsigned eventCount, unsigned k) {
+        return t[k].eventCode < eventCount;
+    }
+};
+
+struct _OFSMTableCheckHandler {
+    template<unsigned TN, unsigned HN>
+    static constexpr bool check(const OFSMTableTransition (&t)[TN], const OFSMHandler (&h)[HN], unsigned, unsigned, unsigned k) {
+        return t[k].nop || (t[k].eventHandler != nullptr && _ofsm_table_find_handler(h, t[k].eventHandler, 0, HN) != HN);
+    }
+};
+
+struct _OFSMTableCheckOrder {
+    template<unsigned TN, unsigned HN>
+    static constexpr bool check(const OFSMTableTransition (&t)[TN], const OFSMHandler (&)[HN], unsigned, unsigned, unsigned k) {
+        return k == 0 || _ofsm_table_key(t[k - 1]) < _ofsm_table_key(t[k]);
+    }
+};
+
+template<class Check, unsigned TN, unsigned HN>
+constexpr bool _ofsm_table_check(const OFSMTableTransition (&t)[TN], const OFSMHandler (&h)[HN], unsigned stateCount, unsigned eventCount, unsigned lo, unsigned hi) {
+    return hi <= lo ? true
+        : hi - lo == 1 ? Check::check(t, h, stateCount, eventCount, lo)
+        : _ofsm_table_check<Check>(t, h, stateCount, eventCount, lo, lo + (hi - lo) / 2)
+            && _ofsm_table_check<Check>(t, h, stateCount, eventCount, lo + (hi - lo) / 2, hi);
+}
+
+template<class Check, unsigned TN, unsigned HN>
+constexpr bool _ofsm_table_check_all(const OFSMTableTransition (&t)[TN], const OFSMHandler (&h)[HN], unsigned stateCount, unsigned eventCount) {
+    return _ofsm_table_check<Check>(t, h, stateCount, eventCount, 0, TN);
+}
+
+template<unsigned N, class T>
+constexpr unsigned _ofsm_table_size(const T (&)[N]) {
+    return N;
+}
+
+/*cells of the table, Table::cell(i) supplies i-th cell*/
+template<class Table, class Seq> struct _OFSMCompactTable;
+template<class Table, unsigned... I> struct _OFSMCompactTable<Table, _OFSMIndexSequence<I...> > {
+    static const OFSMCompactTransition cells[sizeof...(I)];
+};
+template<class Table, unsigned... I>
+const OFSMCompactTransition _OFSMCompactTable<Table, _OFSMIndexSequence<I...> >::cells[sizeof...(I)] OFSM_FLASH = { Table::cell(I)... };
+
+/*----------------------------------------------
+Declaration macros
+-----------------------------------------------*/
+#define OFSM_DECLARE_COMPACT_TRANSITION_TABLE(tableId, handlers, transitions, stateCount, eventCount) \
+    static_assert((stateCount) > 0 && (stateCount) <= (OFSM_CONFIG_INDEX_TYPE)-1, "OFSM table " #tableId ": state count must be within 1..max value of OFSM_CONFIG_INDEX_TYPE"); \
+    static_assert((eventCount) > 0 && (eventCount) <= (OFSM_CONFIG_INDEX_TYPE)-1, "OFSM table " #tableId ": event count must be within 1..max value of OFSM_CONFIG_INDEX_TYPE"); \
+    static_assert(_ofsm_table_size(handlers) < OFSM_COMPACT_NOP_HANDLER_INDEX, "OFSM table " #tableId ": too many handlers"); \
+    static_assert(_ofsm_table_check_all<_OFSMTableCheckState>(transitions, handlers, stateCount, eventCount), "OFSM table " #tableId ": state or new state is out of range"); \
+    static_assert(_ofsm_table_check_all<_OFSMTableCheckEvent>(transitions, handlers, stateCount, eventCount), "OFSM table " #tableId ": event code is out of range"); \
+    static_assert(_ofsm_table_check_all<_OFSMTableCheckHandler>(transitions, handlers, stateCount, eventCount), "OFSM table " #tableId ": handler is missing in handler array"); \
+    static_assert(_ofsm_table_check_all<_OFSMTableCheckOrder>(transitions, handlers, stateCount, eventCount), "OFSM table " #tableId ": transitions must be sorted by state, then by event code, without duplicates"); \
+    struct _ofsm_decl_ctt_##tableId { \
+        static constexpr OFSM_CONFIG_INDEX_TYPE stateCount_ = (stateCount); \
+        static constexpr OFSM_CONFIG_INDEX_TYPE eventCount_ = (eventCount); \
+        static constexpr OFSMCompactTransition cell(unsigned i) { return _ofsm_table_cell(transitions, handlers, eventCount, i); } \
+        static constexpr const OFSMHandler* handlers_() { return handlers; } \
+    }; \
+    typedef _OFSMCompactTable<_ofsm_decl_ctt_##tableId, _OFSMMakeIndexSequence<(stateCount) * (eventCount)>::type> _ofsm_decl_ctt_cells_##tableId
+
+#define OFSM_DECLARE_COMPACT_FSM(fsmId, tableId, initializationHandler, fsmPrivateDataPtr, initialState) \
+    _OFSM_DECLARE_FSM(fsmId, _ofsm_decl_ctt_cells_##tableId::cells, _ofsm_decl_ctt_##tableId::stateCount_, _ofsm_decl_ctt_##tableId::eventCount_, \
+        _OFSM_TRANSITION_TABLE_TYPE_COMPACT, _ofsm_decl_ctt_##tableId::handlers_(), initializationHandler, fsmPrivateDataPtr, initialState)
+
+#endif /*__OFSM_TABLE_H_*/
@@ -0,0 +1,64 @@
+//OFSM pool group tests.
+//Compiler Command line: g++ -Wall -std=c++11 -fexceptions -I../src -g -o ofsmPoolTest ofsmPoolTest.cpp
+//Usage: ofsmPoolTest ofsmPoolTest.test
+//
+//Pool group of 9 instances (group 0) next to ordinary group of 2 fsms (group 1), both run the same state machine.
+//Start handler sets transition delay of 1 + fsm index, so that every instance has its own wakeup time.
+//Wakeup index and pending group bitmap are switched from the command line (see ofsmPoolTest.test).
+
+#define OFSM_CONFIG_SIMULATION
+#define OFSM_CONFIG_SIMULATION_SCRIPT_MODE
+#define OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE 1
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL 0
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM 0
+#define OFSM_CONFIG_FSM_POOL
+
+#include <ofsm.h>
+
+#define EVENT_QUEUE_SIZE 3
+#define POOL_SIZE 9
+
+/*define events*/
+enum Events {Timeout = 0, Start, Stop};
+enum States {Idle = 0, Running};
+enum FsmId	{Fsm0 = 0, Fsm1};
+enum FsmGrpId {PoolGroup = 0, Group1};
+
+/* Handlers declaration */
+void StartHandler();
+void StopHandler();
+void DummyHandler();
+
+/* OFSM configuration */
+OFSMTransition transitionTable[][1 + Stop] = {
+    /* timeout,             Start,                    Stop*/
+    { { 0,            0 },{ StartHandler, Running },{ 0,           0    } }, //Idle
+    { { DummyHandler, Idle },{ 0,           0       },{ StopHandler, Idle } }, //Running
+};
+
+OFSM_DECLARE_FSM_POOL(PoolGroup, EVENT_QUEUE_SIZE, POOL_SIZE, transitionTable, 1 + Stop, NULL, NULL, Idle);
+OFSM_DECLARE_FSM(Fsm0, transitionTable, 1 + Stop, NULL, NULL, Idle);
+OFSM_DECLARE_FSM(Fsm1, transitionTable, 1 + Stop, NULL, NULL, Idle);
+OFSM_DECLARE_GROUP_2(Group1, EVENT_QUEUE_SIZE, Fsm0, Fsm1);
+OFSM_DECLARE_2(PoolGroup, Group1);
+
+/* Setup */
+void setup() {
+    OFSM_SETUP();
+}
+
+void loop() {
+    OFSM_LOOP();
+}
+
+/* Handler implementation */
+void StartHandler() {
+    fsm_set_transition_delay(1 + fsm_get_fsm_index());
+}
+
+void StopHandler() {
+    fsm_set_infinite_delay();
+}
+
+void DummyHandler() {
+}
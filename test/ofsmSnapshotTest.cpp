@@ -0,0 +1,95 @@
+//OFSM snapshot (checkpoint) tests.
+//Compiler Command line: g++ -Wall -std=c++11 -fexceptions -I../src -g -o ofsmSnapshotTest ofsmSnapshotTest.cpp
+//Usage: ofsmSnapshotTest ofsmSnapshotTest.test
+//
+//Same state machine as ofsmTest.cpp, in two groups of one fsm. Custom commands:
+//  l[ayout],<group count>  - sets OFSM up again with first <group count> groups (changes layout of snapshot); output: -L(<group count>)
+//  x,s|r                   - ofsm_snapshot_save()/ofsm_snapshot_restore() with sketch buffer; output: -X-S(<size>), -X-R(<1 - restored, 0 - rejected>)
+
+#define OFSM_CONFIG_SIMULATION
+#define OFSM_CONFIG_SIMULATION_SCRIPT_MODE
+#define OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE 3
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL 0
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM 0
+#define OFSM_CONFIG_DEFAULT_STATE_TRANSITION_DELAY 1
+#define OFSM_CONFIG_SNAPSHOT
+
+#include <deque>
+#include <string>
+bool snapshotTestCommand(std::deque<std::string> &tokens);
+#define OFSM_CONFIG_CUSTOM_SIMULATION_COMMAND_HOOK_FUNC snapshotTestCommand
+
+#include <ofsm.h>
+
+#define EVENT_QUEUE_SIZE 3
+
+/*define events*/
+enum Events {Timeout = 0, NormalTransition, PreventTransition, InfiniteDelay};
+enum States {S0 = 0, S1};
+enum FsmId	{Fsm0 = 0, Fsm1};
+enum FsmGrpId {Group0 = 0, Group1};
+
+/* Handlers declaration */
+void DummyHandler();
+void PreventTransitionHandler();
+void InifiniteDelayHandler();
+
+/* OFSM configuration */
+OFSMTransition transitionTable[][1 + InfiniteDelay] = {
+    /* timeout,               NormalTransition,    PreventTransition,               InifiniteDelay*/
+    { { DummyHandler, S1 },{ DummyHandler, S1 },{ PreventTransitionHandler, S1 },{ InifiniteDelayHandler, S1 } }, //S0
+    { { 0,			  0  },{ DummyHandler, S0 },{ PreventTransitionHandler, S0 },{ InifiniteDelayHandler, S0 } }, //S1
+};
+
+OFSM_DECLARE_FSM(Fsm0, transitionTable, 1 + InfiniteDelay, NULL, NULL, 0);
+OFSM_DECLARE_FSM(Fsm1, transitionTable, 1 + InfiniteDelay, NULL, NULL, 0);
+OFSM_DECLARE_GROUP_1(Group0, EVENT_QUEUE_SIZE, Fsm0);
+OFSM_DECLARE_GROUP_1(Group1, EVENT_QUEUE_SIZE, Fsm1);
+OFSM_DECLARE_2(Group0, Group1);
+
+uint8_t snapshotBuffer[1024];
+uint32_t snapshotSize;
+
+/* Setup */
+void setup() {
+    OFSM_SETUP();
+}
+
+void loop() {
+    OFSM_LOOP();
+}
+
+/* Custom commands */
+bool snapshotTestCommand(std::deque<std::string> &tokens) {
+    char buf[32];
+    if (tokens[0] == "l" || tokens[0] == "layout") {
+        int groupCount = (tokens.size() > 1 ? atoi(tokens[1].c_str()) : 2);
+        OFSM_SETUP_GROUPS(_ofsm_decl_grp_arr, groupCount);
+        _ofsm_snprintf(buf, sizeof(buf), "-L(%i)", groupCount);
+    }
+    else if (tokens[0] == "x" && tokens.size() > 1 && tokens[1] == "s") {
+        snapshotSize = ofsm_snapshot_save(snapshotBuffer, sizeof(snapshotBuffer));
+        _ofsm_snprintf(buf, sizeof(buf), "-X-S(%lu)", (unsigned long)snapshotSize);
+    }
+    else if (tokens[0] == "x" && tokens.size() > 1 && tokens[1] == "r") {
+        _ofsm_snprintf(buf, sizeof(buf), "-X-R(%i)", (int)ofsm_snapshot_restore(snapshotBuffer, snapshotSize));
+    }
+    else {
+        return false;
+    }
+    ofsm_simulation_set_assert_compare_string(buf);
+    std::cout << buf << std::endl;
+    return true;
+}
+
+/* Handler implementation */
+void DummyHandler() {
+}
+
+void PreventTransitionHandler() {
+    fsm_prevent_transition();
+}
+
+void InifiniteDelayHandler() {
+    fsm_set_infinite_delay();
+}
@@ -1,4 +1,7 @@
 #include "ofsmTest.h"
+#ifdef OFSM_CONFIG_COMPACT_TRANSITION_TABLE
+#   include <ofsm.table.h>
+#endif
 #include <ofsm.impl.h>
 
 /*define events*/
@@ -13,13 +16,42 @@ void PreventTransitionHandler();
 void InifiniteDelayHandler();
 
 /* OFSM configuration */
-OFSMTransition transitionTable[][1 + InfiniteDelay] = {
+/*tables are declared as OFSM_CONFIG_TRANSITION_TABLE_IN_FLASH requires, OFSM_FLASH is empty without it*/
+#if defined(OFSM_CONFIG_COMPACT_TRANSITION_TABLE)
+/*the same table through compile-time front end (ofsm.table.h): S1 doesn't handle timeout*/
+constexpr OFSMHandler handlers[] OFSM_FLASH = { DummyHandler, PreventTransitionHandler, InifiniteDelayHandler };
+constexpr OFSMTableTransition transitions[] = {
+    ofsm_transition(S0, Timeout, DummyHandler, S1),
+    ofsm_transition(S0, NormalTransition, DummyHandler, S1),
+    ofsm_transition(S0, PreventTransition, PreventTransitionHandler, S1),
+    ofsm_transition(S0, InfiniteDelay, InifiniteDelayHandler, S1),
+    ofsm_transition(S1, NormalTransition, DummyHandler, S0),
+    ofsm_transition(S1, PreventTransition, PreventTransitionHandler, S0),
+    ofsm_transition(S1, InfiniteDelay, InifiniteDelayHandler, S0),
+};
+OFSM_DECLARE_COMPACT_TRANSITION_TABLE(TestTable, handlers, transitions, 1 + S1, 1 + InfiniteDelay);
+OFSM_DECLARE_COMPACT_FSM(DefaultFsm, TestTable, NULL, NULL, 0);
+#elif defined(OFSM_CONFIG_SPARSE_TRANSITION_TABLE)
+/*the same table as sparse rows: timeout is the first entry of S0 row and isn't handled by S1,
+the last event (InifiniteDelay) is the last entry before terminator in both rows*/
+const OFSMSparseTransition s0Row[] OFSM_FLASH = {
+    { Timeout, DummyHandler, S1 }, { NormalTransition, DummyHandler, S1 }, { PreventTransition, PreventTransitionHandler, S1 }, { InfiniteDelay, InifiniteDelayHandler, S1 },
+    OFSM_SPARSE_TRANSITION_END };
+const OFSMSparseTransition s1Row[] OFSM_FLASH = {
+    { NormalTransition, DummyHandler, S0 }, { PreventTransition, PreventTransitionHandler, S0 }, { InfiniteDelay, InifiniteDelayHandler, S0 },
+    OFSM_SPARSE_TRANSITION_END };
+const OFSMSparseTransition * const sparseTable[] OFSM_FLASH = { s0Row, s1Row };
+
+OFSM_DECLARE_SPARSE_FSM(DefaultFsm, sparseTable, 1 + InfiniteDelay, NULL, NULL, 0);
+#else
+const OFSMTransition transitionTable[][1 + InfiniteDelay] OFSM_FLASH = {
     /* timeout,               NormalTransition,    PreventTransition,               InifiniteDelay*/
     { { DummyHandler, S1 },{ DummyHandler, S1 },{ PreventTransitionHandler, S1 },{ InifiniteDelayHandler, S1 } }, //S0
     { { 0,			  0  },{ DummyHandler, S0 },{ PreventTransitionHandler, S0 },{ InifiniteDelayHandler, S0 } }, //S1
 };
 
 OFSM_DECLARE_FSM(DefaultFsm, transitionTable, 1 + InfiniteDelay, NULL, NULL, 0);
+#endif
 OFSM_DECLARE_GROUP_1(MainGroup, EVENT_QUEUE_SIZE, DefaultFsm);
 OFSM_DECLARE_1(MainGroup);
 
@@ -0,0 +1,56 @@
+//OFSM virtual time tests.
+//Compiler Command line: g++ -Wall -std=c++11 -fexceptions -I../src -g -o ofsmVirtualTimeTest ofsmVirtualTimeTest.cpp
+//Usage: ofsmVirtualTimeTest ofsmVirtualTimeTest.test
+//
+//Group of 2 periodic fsms: once started, each of them times out every 3 + 2 * fsm index ticks (3 and 5) and schedules the next timeout
+//relative to the time it was woken up at. Thus their wakeup times tell whether every intermediate wakeup time was visited.
+
+#define OFSM_CONFIG_SIMULATION
+#define OFSM_CONFIG_SIMULATION_VIRTUAL_TIME
+#define OFSM_CONFIG_SIMULATION_SCRIPT_MODE_WAKEUP_TYPE 1
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL 0
+#define OFSM_CONFIG_SIMULATION_DEBUG_LEVEL_OFSM 0
+
+#include <ofsm.h>
+
+#define EVENT_QUEUE_SIZE 3
+
+/*define events*/
+enum Events {Timeout = 0, Start, Stop};
+enum States {Idle = 0, Running};
+enum FsmId	{Fsm0 = 0, Fsm1};
+enum FsmGrpId {MainGroup = 0};
+
+/* Handlers declaration */
+void TickHandler();
+void StopHandler();
+
+/* OFSM configuration */
+OFSMTransition transitionTable[][1 + Stop] = {
+    /* timeout,                Start,                  Stop*/
+    { { 0,           0       },{ TickHandler, Running },{ 0,           0    } }, //Idle
+    { { TickHandler, Running },{ 0,           0       },{ StopHandler, Idle } }, //Running
+};
+
+OFSM_DECLARE_FSM(Fsm0, transitionTable, 1 + Stop, NULL, NULL, Idle);
+OFSM_DECLARE_FSM(Fsm1, transitionTable, 1 + Stop, NULL, NULL, Idle);
+OFSM_DECLARE_GROUP_2(MainGroup, EVENT_QUEUE_SIZE, Fsm0, Fsm1);
+OFSM_DECLARE_1(MainGroup);
+
+/* Setup */
+void setup() {
+    OFSM_SETUP();
+}
+
+void loop() {
+    OFSM_LOOP();
+}
+
+/* Handler implementation */
+void TickHandler() {
+    fsm_set_transition_delay(3 + 2 * fsm_get_fsm_index());
+}
+
+void StopHandler() {
+    fsm_set_infinite_delay();
+}
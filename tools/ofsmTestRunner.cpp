@@ -0,0 +1,294 @@
+//GCC build cmd:  g++ -O2 -std=c++11 -o ofsmTestRunner ofsmTestRunner.cpp -lpthread
+//Usage: ofsmTestRunner [-j <jobs>] [-t <timeout seconds>] [-v] [-b] <sketch executable> <script.test> [<script.test> ...]
+//  -j  number of cases executed in parallel (default: number of cores)
+//  -t  case is killed and reported as failed when it runs longer (default: 60)
+//  -v  print output of every case (in script order), not only of the failed ones
+//  -b  binary script round trip: every case is also compiled (<sketch executable> -c) and the binary script is replayed;
+//      case fails if compilation fails or replay output differs from the output of the text script
+//
+//Parallel runner of simulation scripts. Every script is split at r[eset] commands into independent cases, which are executed
+//by separate processes of the sketch executable. Case script is padded with empty lines in front, so that 'ASSERT at line:'
+//messages report line numbers of the original script. e[xit] ends the case it appears in; the rest of the script is not executed,
+//the same as with serial run. Cases should not depend on sketch state that is not restored by reset.
+//Case fails if it prints 'ASSERT at line:', returns non-zero exit code or times out. Runner returns number of failed cases.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <spawn.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+struct TestCase {
+    std::string scriptName;
+    int firstLine;              /*1 based, first line of the case in the script*/
+    int lastLine;
+    std::string script;         /*padded with empty lines up to the first line*/
+    std::string output;
+    std::string binaryOutput;   /*-b: output of replayed binary script*/
+    int exitCode;
+    bool timedOut;
+    bool failed;
+};
+
+static std::vector<TestCase> cases;
+static std::atomic<size_t> nextCase;
+static const char *sketchPath;
+static int timeoutSeconds = 60;
+static bool binaryRoundTrip;
+
+/*command letter of the script line the same way event generator sees it: trimmed, comment stripped, lower case; 0 for empty line*/
+static char commandLetter(const std::string &line) {
+    size_t begin = line.find_first_not_of(" \t\r\n\v\f");
+    if (begin == std::string::npos || !line.compare(begin, 2, "//")) {
+        return 0;
+    }
+    return (char)tolower((unsigned char)line[begin]);
+}
+
+static bool splitScript(const char *scriptName) {
+    std::ifstream in(scriptName);
+    std::string line;
+    std::string body;
+    int lineNumber = 0;
+    int firstLine = 1;
+    bool exited = false;
+    char c;
+
+    if (!in.is_open()) {
+        fprintf(stderr, "Cannot open '%s'.\n", scriptName);
+        return false;
+    }
+    while (!exited && std::getline(in, line)) {
+        lineNumber++;
+        body += line;
+        body += '\n';
+        c = commandLetter(line);
+        exited = (c == 'e');
+        if (c == 'r' || exited || in.peek() == EOF) {
+            TestCase tc;
+            tc.scriptName = scriptName;
+            tc.firstLine = firstLine;
+            tc.lastLine = lineNumber;
+            tc.script.assign(firstLine - 1, '\n');
+            tc.script += body;
+            tc.exitCode = 0;
+            tc.timedOut = false;
+            tc.failed = false;
+            cases.push_back(tc);
+            body.clear();
+            firstLine = lineNumber + 1;
+        }
+    }
+    return true;
+}
+
+static std::string readFile(const char *fileName) {
+    std::ifstream in(fileName, std::ios::in | std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+/*runs sketch executable with given arguments, stdout and stderr go to output. Returns exit code, -1 if it couldn't be started or was killed*/
+static int runSketch(char *const argv[], std::string &output, bool &timedOut) {
+    char outputFile[] = "/tmp/ofsmTestOutXXXXXX";
+    int outputFd = mkstemp(outputFile);
+    posix_spawn_file_actions_t actions;
+    pid_t pid;
+    int status = 0;
+    int exitCode = -1;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (outputFd < 0) {
+        output = "Cannot create temporary files.\n";
+        return -1;
+    }
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, outputFd, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, outputFd, STDERR_FILENO);
+    if (posix_spawn(&pid, sketchPath, &actions, NULL, argv, environ)) {
+        output = std::string("Cannot start '") + sketchPath + "'.\n";
+    }
+    else {
+        while (waitpid(pid, &status, WNOHANG) == 0) {
+            if (std::chrono::steady_clock::now() - start > std::chrono::seconds(timeoutSeconds)) {
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+                timedOut = true;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        exitCode = (WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        output = readFile(outputFile);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    close(outputFd);
+    unlink(outputFile);
+    return exitCode;
+}
+
+static void runCase(TestCase &tc) {
+    char scriptFile[] = "/tmp/ofsmTestCaseXXXXXX";
+    char binaryFile[] = "/tmp/ofsmTestBinXXXXXX";
+    int scriptFd = mkstemp(scriptFile);
+    int binaryFd = -1;
+    char *argv[5];
+    std::string compileOutput;
+
+    if (scriptFd < 0 || write(scriptFd, tc.script.c_str(), tc.script.length()) != (ssize_t)tc.script.length()) {
+        tc.output = "Cannot create temporary files.\n";
+        tc.exitCode = -1;
+    }
+    else {
+        argv[0] = (char*)sketchPath;
+        argv[1] = scriptFile;
+        argv[2] = NULL;
+        tc.exitCode = runSketch(argv, tc.output, tc.timedOut);
+        if (binaryRoundTrip && !tc.exitCode && !tc.timedOut) {
+            binaryFd = mkstemp(binaryFile);
+            argv[1] = (char*)"-c";
+            argv[2] = scriptFile;
+            argv[3] = binaryFile;
+            argv[4] = NULL;
+            if (binaryFd < 0 || runSketch(argv, compileOutput, tc.timedOut)) {
+                tc.output += "ASSERT at line: 0: Cannot compile binary script.\n\t" + compileOutput;
+            }
+            else {
+                argv[1] = binaryFile;
+                argv[2] = NULL;
+                tc.exitCode = runSketch(argv, tc.binaryOutput, tc.timedOut);
+                if (tc.binaryOutput != tc.output) {
+                    tc.output += "ASSERT at line: 0: Output of binary script differs.\n";
+                }
+            }
+        }
+    }
+    if (scriptFd >= 0) {
+        close(scriptFd);
+        unlink(scriptFile);
+    }
+    if (binaryFd >= 0) {
+        close(binaryFd);
+        unlink(binaryFile);
+    }
+    tc.failed = (tc.timedOut || tc.exitCode != 0 || tc.output.find("ASSERT at line:") != std::string::npos);
+}
+
+static void worker() {
+    size_t i;
+    while ((i = nextCase++) < cases.size()) {
+        runCase(cases[i]);
+    }
+}
+
+/*assert messages with their Expected/Produced lines*/
+static void printAsserts(const std::string &output) {
+    std::istringstream in(output);
+    std::string line;
+    bool inAssert = false;
+    while (std::getline(in, line)) {
+        if (!line.compare(0, 15, "ASSERT at line:")) {
+            inAssert = true;
+        }
+        else if (inAssert && line.compare(0, 1, "\t")) {
+            inAssert = false;
+        }
+        if (inAssert) {
+            printf("    %s\n", line.c_str());
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    unsigned jobs = std::thread::hardware_concurrency();
+    bool verbose = false;
+    std::vector<std::thread> threads;
+    size_t i, failed = 0;
+    int a;
+
+    for (a = 1; a < argc && argv[a][0] == '-'; a++) {
+        if (!strcmp(argv[a], "-j") && a + 1 < argc) {
+            jobs = (unsigned)atoi(argv[++a]);
+        }
+        else if (!strcmp(argv[a], "-t") && a + 1 < argc) {
+            timeoutSeconds = atoi(argv[++a]);
+        }
+        else if (!strcmp(argv[a], "-v")) {
+            verbose = true;
+        }
+        else if (!strcmp(argv[a], "-b")) {
+            binaryRoundTrip = true;
+        }
+        else {
+            break;
+        }
+    }
+    if (argc - a < 2) {
+        fprintf(stderr, "Usage: %s [-j <jobs>] [-t <timeout seconds>] [-v] [-b] <sketch executable> <script.test> [<script.test> ...]\n", argv[0]);
+        return 255;
+    }
+    sketchPath = argv[a++];
+    for (; a < argc; a++) {
+        if (!splitScript(argv[a])) {
+            return 255;
+        }
+    }
+    if (!jobs) {
+        jobs = 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (i = 0; i < jobs && i < cases.size(); i++) {
+        threads.push_back(std::thread(worker));
+    }
+    for (i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    double ms = (double)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    for (i = 0; i < cases.size(); i++) {
+        TestCase &tc = cases[i];
+        if (tc.failed) {
+            failed++;
+        }
+        if (!tc.failed && !verbose) {
+            continue;
+        }
+        printf("%s: lines %i-%i %s", tc.scriptName.c_str(), tc.firstLine, tc.lastLine, (tc.failed ? "FAILED" : "passed"));
+        if (tc.timedOut) {
+            printf(" (timed out after %i s)", timeoutSeconds);
+        }
+        else if (tc.exitCode) {
+            printf(" (exit code %i)", tc.exitCode);
+        }
+        printf("\n");
+        if (verbose) {
+            fwrite(tc.output.c_str(), 1, tc.output.length(), stdout);
+            if (tc.failed && !tc.binaryOutput.empty()) {
+                printf("  binary script output:\n");
+                fwrite(tc.binaryOutput.c_str(), 1, tc.binaryOutput.length(), stdout);
+            }
+        }
+        else {
+            printAsserts(tc.output);
+            printAsserts(tc.binaryOutput);
+        }
+    }
+    printf("ofsm_test_runner cases=%lu passed=%lu failed=%lu jobs=%u ms=%.0f\n",
+        (unsigned long)cases.size(), (unsigned long)(cases.size() - failed), (unsigned long)failed, jobs, ms);
+    return (failed > 254 ? 254 : (int)failed);
+}
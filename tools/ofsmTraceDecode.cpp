@@ -0,0 +1,205 @@
+//GCC build cmd:  g++ -O2 -std=c++11 -o ofsmTraceDecode ofsmTraceDecode.cpp
+//Usage: ofsmTraceDecode [-j] [-u <microseconds per tick>] <trace dump file>
+//  -j  Chrome trace JSON (chrome://tracing, Perfetto) instead of text
+//  -u  tick length used for JSON time stamps (default: 1000, i.e. 1 tick = 1ms)
+//
+//Decodes binary trace written by ofsm_trace_dump() (OFSM_CONFIG_TRACE_BUFFER_SIZE): 16 bytes header followed by 16 bytes records.
+//Standalone on purpose (dump may come from MCU), record layout and types below must match OFSMTraceRecord and _OFSM_TRACE_... in ofsm.decl.h.
+//Text output: one line per record: <time> <TYPE> G(<group>) F(<fsm>) ...
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+enum TraceType { Enqueue = 1, Drop, Dispatch, Transition, Delay, SleepEnter, SleepExit, Heartbeat };
+
+#define TRACE_FLAG_REPLACED     0x1
+#define TRACE_INFINITE          0xFFFFFFFFUL
+#define TRACE_HEADER_SIZE       16
+#define TRACE_RECORD_SIZE       16
+
+struct TraceRecord {
+    uint32_t time;
+    uint32_t value;
+    uint16_t groupIndex;
+    uint16_t fsmIndex;
+    uint16_t code;
+    uint8_t  type;
+    uint8_t  flags;
+};
+
+/*dump is little-endian (AVR and x86)*/
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static const char *typeName(uint8_t type) {
+    switch (type) {
+    case Enqueue:       return "ENQUEUE";
+    case Drop:          return "DROP";
+    case Dispatch:      return "DISPATCH";
+    case Transition:    return "TRANSITION";
+    case Delay:         return "DELAY";
+    case SleepEnter:    return "SLEEP_ENTER";
+    case SleepExit:     return "SLEEP_EXIT";
+    case Heartbeat:     return "HEARTBEAT";
+    }
+    return "UNKNOWN";
+}
+
+static void printText(const TraceRecord &r) {
+    printf("%10lu %-11s", (unsigned long)r.time, typeName(r.type));
+    switch (r.type) {
+    case Enqueue:
+        printf(" G(%u) event %u data %lu%s\n", r.groupIndex, r.code, (unsigned long)r.value, (r.flags & TRACE_FLAG_REPLACED ? " replaced" : ""));
+        break;
+    case Drop:
+        printf(" G(%u) event %u data %lu (queue overflow)\n", r.groupIndex, r.code, (unsigned long)r.value);
+        break;
+    case Dispatch:
+        printf(" G(%u) F(%u) event %u state %lu\n", r.groupIndex, r.fsmIndex, r.code, (unsigned long)r.value);
+        break;
+    case Transition:
+        printf(" G(%u) F(%u) event %u state %lu ==> %lu\n", r.groupIndex, r.fsmIndex, r.code, (unsigned long)(r.value >> 16), (unsigned long)(r.value & 0xFFFF));
+        break;
+    case Delay:
+        if (r.value == TRACE_INFINITE) {
+            printf(" G(%u) F(%u) state %u delay infinite\n", r.groupIndex, r.fsmIndex, r.code);
+        }
+        else {
+            printf(" G(%u) F(%u) state %u delay %lu\n", r.groupIndex, r.fsmIndex, r.code, (unsigned long)r.value);
+        }
+        break;
+    case SleepEnter:
+        if (r.value == TRACE_INFINITE) {
+            printf(" wakeup infinite%s\n", (r.flags ? " deep" : ""));
+        }
+        else {
+            printf(" wakeup %lu%s\n", (unsigned long)r.value, (r.flags ? " deep" : ""));
+        }
+        break;
+    case SleepExit:
+        printf("\n");
+        break;
+    case Heartbeat:
+        printf(" wakeup %lu reached\n", (unsigned long)r.value);
+        break;
+    default:
+        printf(" type %u group %u fsm %u code %u flags %u value %lu\n", r.type, r.groupIndex, r.fsmIndex, r.code, r.flags, (unsigned long)r.value);
+        break;
+    }
+}
+
+/*ofsm activity (sleep, heartbeat) goes to tid 0, group activity to tid <group index> + 1; sleep is a duration event, the rest are instant*/
+static void printJson(const TraceRecord &r, double usPerTick, bool first) {
+    double ts = r.time * usPerTick;
+    const char *phase = "i";
+    unsigned long tid = 0;
+    char name[64];
+
+    snprintf(name, sizeof(name), "%s", typeName(r.type));
+    switch (r.type) {
+    case Enqueue:
+    case Drop:
+        tid = r.groupIndex + 1UL;
+        snprintf(name, sizeof(name), "%s E%u", typeName(r.type), r.code);
+        break;
+    case Dispatch:
+    case Transition:
+    case Delay:
+        tid = r.groupIndex + 1UL;
+        snprintf(name, sizeof(name), "%s F%u", typeName(r.type), r.fsmIndex);
+        break;
+    case SleepEnter:
+        phase = "B";
+        snprintf(name, sizeof(name), "sleep");
+        break;
+    case SleepExit:
+        phase = "E";
+        snprintf(name, sizeof(name), "sleep");
+        break;
+    }
+    printf("%s{\"name\":\"%s\",\"ph\":\"%s\",%s\"ts\":%.3f,\"pid\":0,\"tid\":%lu,\"args\":{\"group\":%u,\"fsm\":%u,\"code\":%u,\"flags\":%u,\"value\":%lu}}",
+        (first ? "\n" : ",\n"), name, phase, (phase[0] == 'i' ? "\"s\":\"t\"," : ""), ts, tid, r.groupIndex, r.fsmIndex, r.code, r.flags, (unsigned long)r.value);
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    double usPerTick = 1000;
+    const char *fileName = NULL;
+    uint8_t header[TRACE_HEADER_SIZE];
+    uint8_t buf[TRACE_RECORD_SIZE];
+    std::vector<TraceRecord> records;
+    uint32_t count, total, i;
+    int a;
+
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "-j")) {
+            json = true;
+        }
+        else if (!strcmp(argv[a], "-u") && a + 1 < argc) {
+            usPerTick = atof(argv[++a]);
+        }
+        else {
+            fileName = argv[a];
+        }
+    }
+    if (!fileName) {
+        fprintf(stderr, "Usage: %s [-j] [-u <microseconds per tick>] <trace dump file>\n", argv[0]);
+        return 2;
+    }
+
+    FILE *f = fopen(fileName, "rb");
+    if (!f) {
+        fprintf(stderr, "Cannot open '%s'.\n", fileName);
+        return 1;
+    }
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) || memcmp(header, "OFTR", 4)) {
+        fprintf(stderr, "'%s' is not ofsm trace dump.\n", fileName);
+        fclose(f);
+        return 1;
+    }
+    if (le16(header + 4) != 1 || le16(header + 6) != TRACE_RECORD_SIZE) {
+        fprintf(stderr, "Unsupported trace version %u (record size %u).\n", le16(header + 4), le16(header + 6));
+        fclose(f);
+        return 1;
+    }
+    count = le32(header + 8);
+    total = le32(header + 12);
+    for (i = 0; i < count && fread(buf, 1, sizeof(buf), f) == sizeof(buf); i++) {
+        TraceRecord r;
+        r.time = le32(buf);
+        r.value = le32(buf + 4);
+        r.groupIndex = le16(buf + 8);
+        r.fsmIndex = le16(buf + 10);
+        r.code = le16(buf + 12);
+        r.type = buf[14];
+        r.flags = buf[15];
+        records.push_back(r);
+    }
+    fclose(f);
+    if (records.size() != count) {
+        fprintf(stderr, "Truncated dump: %lu of %lu records.\n", (unsigned long)records.size(), (unsigned long)count);
+    }
+
+    if (json) {
+        printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+        for (i = 0; i < records.size(); i++) {
+            printJson(records[i], usPerTick, !i);
+        }
+        printf("\n]}\n");
+    }
+    else {
+        printf("# records %lu, emitted %lu, overwritten %lu\n", (unsigned long)count, (unsigned long)total, (unsigned long)(total - count));
+        for (i = 0; i < records.size(); i++) {
+            printText(records[i]);
+        }
+    }
+    return 0;
+}